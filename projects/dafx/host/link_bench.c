@@ -0,0 +1,724 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   End to end benchmark of the host to register path: frame encoding, CRC,
+//   UART transfer, parse_uart_rx(), cmd_dispatch(), the handlers, the TX
+//   multiplexer and the reply. Without --port the firmware sources are run in
+//   a thread behind a socketpair, with the PS UART simulated at the baud rate
+//   (xil_shim/). With --port the board is driven over a real serial port.
+//
+//   Every combination of baud rate, CRC mode, command mix and echo size is run
+//   for --commands commands or --seconds seconds and printed as one JSON
+//   object per line.
+//
+//     read   'R' of the hardware version register
+//     write  Seven 'W' of the output gain with its own value and one 'R'
+//     echo   'E' with --sizes payload bytes
+//     mixed  'W', 'R' and 'E'
+//
+//   Latency is measured from writing a frame to the end of its reply, for
+//   commands with a reply. At most --window commands are outstanding. The
+//   payload rate only counts the echo payload, one way.
+//
+//   gcc -std=gnu11 -O2 -Wall -pthread -Ixil_shim -I../sw -o link_bench link_bench.c
+//       xil_shim/xil_shim.c $(ls ../sw/*.c | grep -v main) -lm
+//   ./link_bench --bauds 115200,921600,3000000 > sim.jsonl
+//   ./link_bench --port /dev/ttyUSB1 --baud 115200 --bauds 115200,921600
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "xil_shim.h"
+#include "crc_16.h"
+#include "dafx_address.h"
+#include "qhost_defines.h"
+#include "init_ps.h"
+#include "rx_parser.h"
+#include "log_ring.h"
+#include "preset.h"
+#include "sample_stream.h"
+#include "capture.h"
+#include "spectrum.h"
+#include "tx_mux.h"
+#include "link.h"
+
+#define BENCH_LIST_MAX_C     16
+#define BENCH_PENDING_MAX_C  64
+#define BENCH_RX_SIZE_C      65536
+#define BENCH_REPLY_WAIT_MS  200
+
+typedef enum {
+  MIX_READ_E,
+  MIX_WRITE_E,
+  MIX_ECHO_E,
+  MIX_MIXED_E,
+  NR_OF_MIXES_E
+} mix_t;
+
+static const char *mix_names[NR_OF_MIXES_E] = {"read", "write", "echo", "mixed"};
+
+typedef struct {
+  uint64_t sent_ns;
+  uint8_t  opcode;  // 'W' has no reply and completes with the next reply
+} pending_t;
+
+typedef struct {
+  uint32_t  baud_rate;
+  int32_t   crc;
+  mix_t     mix;
+  int32_t   echo_size;
+
+  pending_t pending[BENCH_PENDING_MAX_C];
+  int32_t   nr_of_pending;
+  uint32_t  sent;
+  uint32_t  completed;
+  uint32_t  lost;
+  uint32_t  errors;
+  uint64_t  payload_bytes;
+  uint64_t  host_bytes;
+  uint64_t  board_bytes;
+  uint64_t *latency_ns;
+  uint32_t  nr_of_latencies;
+} run_t;
+
+// Options
+static const char *opt_port;
+static uint32_t    opt_baud      = UART_BAUD_RATE_C;
+static uint32_t    opt_bauds[BENCH_LIST_MAX_C];
+static int32_t     opt_nr_of_bauds;
+static int32_t     opt_crcs[2]   = {1, 0};
+static int32_t     opt_nr_of_crcs = 2;
+static int32_t     opt_mixes[NR_OF_MIXES_E] = {1, 1, 1, 1};
+static int32_t     opt_sizes[BENCH_LIST_MAX_C] = {0, 16, 64, 128, 254};
+static int32_t     opt_nr_of_sizes = 5;
+static uint32_t    opt_commands = 2000;
+static double      opt_seconds  = 0.5;
+static int32_t     opt_window   = 2;
+static int32_t     opt_timeout_ms = 1000;
+
+// Link
+static int         link_fd = -1;
+static int32_t     link_crc = LINK_CRC_DEFAULT_C;
+static uint8_t     link_rx[BENCH_RX_SIZE_C];
+static int32_t     link_rx_length;
+static uint64_t    link_rx_bytes;
+static uint64_t    link_tx_bytes;
+static uint32_t    gain;
+
+// Simulated board
+static pthread_t         board_thread;
+static int               board_fd;
+static volatile int32_t  board_running;
+extern volatile uint32_t uart_rx_wr_addr;
+extern volatile uint32_t uart_rx_rd_addr;
+
+
+// Runs the firmware's init and main loop, see main.c
+static void *board_main(void *arg) {
+
+  sim_uart_attach(*(int *)arg);
+
+  parse_uart_init();
+  tx_mux_init();
+  log_init();
+  preset_init();
+  sample_stream_init();
+  capture_init();
+  spectrum_init();
+  init_uart(XPAR_XUARTPS_0_DEVICE_ID);
+  link_init();
+  init_interrupt();
+
+  while (board_running) {
+
+    // Takes a pending UART interrupt, the others are taken at register accesses
+    sim_uart_poll();
+    if (uart_rx_rd_addr != uart_rx_wr_addr) {
+      parse_uart_rx();
+    }
+    capture_poll();
+    log_drain(LOG_DRAIN_RECORDS_C);
+    tx_mux_poll();
+    link_poll();
+
+    // The host side may share the core
+    sched_yield();
+  }
+  return NULL;
+}
+
+
+static speed_t serial_speed(uint32_t baud_rate) {
+
+  static const struct { uint32_t rate; speed_t speed; } speeds[] = {
+    {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600},
+    {1000000, B1000000}, {2000000, B2000000}, {3000000, B3000000}
+  };
+
+  for (uint32_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+    if (speeds[i].rate == baud_rate) {
+      return speeds[i].speed;
+    }
+  }
+  return B0;
+}
+
+
+static int32_t serial_set_baud(uint32_t baud_rate) {
+
+  struct termios tio;
+
+  if (tcgetattr(link_fd, &tio) != 0 || serial_speed(baud_rate) == B0) {
+    return -1;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~CRTSCTS;
+  cfsetspeed(&tio, serial_speed(baud_rate));
+  return tcsetattr(link_fd, TCSANOW, &tio);
+}
+
+
+static int32_t link_open() {
+
+  int fds[2];
+
+  if (opt_port != NULL) {
+    link_fd = open(opt_port, O_RDWR | O_NOCTTY);
+    if (link_fd < 0 || serial_set_baud(opt_baud) != 0) {
+      perror(opt_port);
+      return -1;
+    }
+    tcflush(link_fd, TCIOFLUSH);
+    return 0;
+  }
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    perror("socketpair");
+    return -1;
+  }
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  link_fd       = fds[0];
+  board_fd      = fds[1];
+  board_running = 1;
+  pthread_create(&board_thread, NULL, board_main, &board_fd);
+  return 0;
+}
+
+
+static void link_close() {
+  if (opt_port == NULL) {
+    board_running = 0;
+    pthread_join(board_thread, NULL);
+  }
+  close(link_fd);
+}
+
+
+// Frames a payload as parse_uart_rx() expects it
+static void link_send(const uint8_t *payload, int32_t length) {
+
+  uint8_t  frame[FRAME_LENGTH_MAX_C + 5];
+  int32_t  index = 0;
+  uint16_t crc;
+  ssize_t  n;
+
+  if (length > 0xFF) {
+    frame[index++] = LENGTH_16_BITS_C;
+    frame[index++] = length >> 8;
+  } else {
+    frame[index++] = LENGTH_8_BITS_C;
+  }
+  frame[index++] = length;
+  memcpy(&frame[index], payload, length);
+  index += length;
+
+  if (link_crc) {
+    crc = crc_16((uint8_t *)payload, length);
+    frame[index++] = crc >> 8;
+    frame[index++] = crc;
+  }
+
+  for (int32_t i = 0; i < index; i += n) {
+    n = write(link_fd, &frame[i], index - i);
+    if (n < 0) {
+      perror("write");
+      exit(1);
+    }
+  }
+  link_tx_bytes += index;
+}
+
+
+// Length of the frame at the start of 'b', 0 if more bytes are needed and -1
+// for a type the benchmark does not know
+static int32_t frame_length(const uint8_t *b, int32_t n) {
+
+  switch (b[0]) {
+    case REGISTER_READ_C: return 9;
+    case LINK_C:          return 9;
+    case ECHO_C:          return (n >= 2)  ? 2 + b[1] : 0;
+    case HELLO_C:         return (n >= 14) ? 14 + 4 * b[13] : 0;
+    case LOG_C:           return (n >= 8)  ? 8 + 4 * (b[7] & 0x0F) : 0;
+    case STRING_C:
+      // xil_printf() text ends in "\n\r", the pair is part of the frame
+      for (int32_t i = 1; i < n; i++) {
+        if (b[i] == '\n' || b[i] == '\r') {
+          if (i + 1 < n && (b[i + 1] == '\n' || b[i + 1] == '\r') && b[i + 1] != b[i]) {
+            return i + 2;
+          }
+          return i + 1;
+        }
+      }
+      return 0;
+    // The rest of a line ending split over two reads
+    case '\n':
+    case '\r':
+      return 1;
+    default:
+      return -1;
+  }
+}
+
+
+// Waits at most 'timeout_ms' for the next reply frame and copies it to
+// 'frame'. Returns its length, or 0 on a timeout. Log and text frames are
+// skipped, unknown bytes are counted in 'errors'.
+static int32_t link_receive(uint8_t *frame, int32_t timeout_ms, uint32_t *errors) {
+
+  struct pollfd pfd = {.fd = link_fd, .events = POLLIN};
+  ssize_t       n;
+  int32_t       length;
+  uint8_t       type;
+
+  while (1) {
+
+    while (link_rx_length > 0) {
+
+      length = frame_length(link_rx, link_rx_length);
+      if (length == 0) {
+        break;
+      }
+      if (length < 0) {
+        (*errors)++;
+        length = 1;
+      }
+      if (length > link_rx_length) {
+        break;
+      }
+
+      type = link_rx[0];
+      if (type != LOG_C && type != STRING_C && length > 1) {
+        memcpy(frame, link_rx, length);
+      }
+      memmove(link_rx, link_rx + length, link_rx_length - length);
+      link_rx_length -= length;
+
+      if (type == REGISTER_READ_C || type == LINK_C || type == ECHO_C || type == HELLO_C) {
+        return length;
+      }
+    }
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+      return 0;
+    }
+    n = read(link_fd, link_rx + link_rx_length, sizeof(link_rx) - link_rx_length);
+    if (n <= 0) {
+      return 0;
+    }
+    link_rx_length += n;
+    link_rx_bytes  += n;
+  }
+}
+
+
+static uint32_t get_uint32(const uint8_t *b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+
+// After a lost reply the parser may wait for the rest of a frame. Zeros fill
+// it and are ignored between frames. With CRC the filled frame is rejected,
+// without CRC it is executed with zero arguments. Late replies are discarded.
+static void link_resync() {
+
+  uint8_t  zeros[FRAME_LENGTH_MAX_C + 4] = {0};
+  uint8_t  frame[FRAME_LENGTH_MAX_C + 2];
+  uint32_t errors = 0;
+  ssize_t  n;
+
+  for (int32_t i = 0; i < (int32_t)sizeof(zeros); i += n) {
+    n = write(link_fd, &zeros[i], sizeof(zeros) - i);
+    if (n < 0) {
+      perror("write");
+      exit(1);
+    }
+  }
+  while (link_receive(frame, BENCH_REPLY_WAIT_MS, &errors) > 0);
+}
+
+
+// HELLO with the current CRC mode, retried until a reply or the timeout
+static int32_t link_hello(uint8_t *reply) {
+
+  uint8_t  hello = 'H';
+  uint32_t errors = 0;
+  uint64_t start = sim_time_ns();
+
+  while (sim_time_ns() - start < (uint64_t)opt_timeout_ms * 1000000) {
+    link_send(&hello, 1);
+    if (link_receive(reply, BENCH_REPLY_WAIT_MS, &errors) > 0 && reply[0] == HELLO_C) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+
+// Runs the switch handshake of link.h
+static int32_t link_switch(uint32_t baud_rate, int32_t crc) {
+
+  uint8_t  frame[FRAME_LENGTH_MAX_C + 2];
+  uint8_t  request[8] = {'B', baud_rate >> 24, baud_rate >> 16, baud_rate >> 8, baud_rate, crc, FRAME_LENGTH_MAX_C >> 8, FRAME_LENGTH_MAX_C & 0xFF};
+  uint32_t errors = 0;
+
+  link_send(request, sizeof(request));
+  if (link_receive(frame, opt_timeout_ms, &errors) == 0 || frame[0] != LINK_C || frame[1] != LINK_ACK_C) {
+    fprintf(stderr, "Switch to %u baud, CRC %d was not acknowledged\n", baud_rate, crc);
+    return -1;
+  }
+
+  if (opt_port != NULL) {
+    tcdrain(link_fd);
+    if (serial_set_baud(baud_rate) != 0) {
+      fprintf(stderr, "%u baud is not supported by the host\n", baud_rate);
+      return -1;
+    }
+  }
+  link_crc = crc;
+
+  if (link_hello(frame) != 0) {
+    fprintf(stderr, "No HELLO at %u baud, CRC %d\n", baud_rate, crc);
+    return -1;
+  }
+  return 0;
+}
+
+
+// Appends one period of the mix, the last command of a period has a reply
+static void run_period(run_t *run) {
+
+  uint8_t   frame[FRAME_LENGTH_MAX_C];
+  int32_t   length;
+  int32_t   index;
+  pending_t *p;
+  const char *sequence;
+
+  switch (run->mix) {
+    case MIX_READ_E:  sequence = "R";        break;
+    case MIX_WRITE_E: sequence = "WWWWWWWR"; break;
+    case MIX_ECHO_E:  sequence = "E";        break;
+    default:          sequence = "WRE";      break;
+  }
+
+  for (; *sequence; sequence++) {
+
+    index    = 0;
+    frame[0] = *sequence;
+
+    if (*sequence == 'R') {
+      frame[1] = 0; frame[2] = 0; frame[3] = 0; frame[4] = DAFX_HARDWARE_VERSION_ADDR;
+      length   = 5;
+    } else if (*sequence == 'W') {
+      frame[1] = 0; frame[2] = 0; frame[3] = 0; frame[4] = DAFX_MIXER_OUTPUT_GAIN_ADDR;
+      frame[5] = gain >> 24; frame[6] = gain >> 16; frame[7] = gain >> 8; frame[8] = gain;
+      length   = 9;
+    } else {
+      for (index = 0; index < run->echo_size; index++) {
+        frame[1 + index] = (uint8_t)(run->sent + index);
+      }
+      length = 1 + run->echo_size;
+    }
+
+    p          = &run->pending[run->nr_of_pending++];
+    p->sent_ns = sim_time_ns();
+    p->opcode  = *sequence;
+    link_send(frame, length);
+    run->sent++;
+  }
+}
+
+
+// Completes the oldest commands up to the one with a reply
+static void run_reply(run_t *run, const uint8_t *frame, int32_t length) {
+
+  uint64_t  now = sim_time_ns();
+  int32_t   done;
+  pending_t *p;
+
+  for (done = 0; done < run->nr_of_pending; done++) {
+    p = &run->pending[done];
+    run->completed++;
+    if (p->opcode == 'E') {
+      run->payload_bytes += run->echo_size;
+    }
+    if (p->opcode != 'W') {
+      run->latency_ns[run->nr_of_latencies++] = now - p->sent_ns;
+      if (p->opcode == 'R' && frame[0] != REGISTER_READ_C) {
+        run->errors++;
+      }
+      if (p->opcode == 'E' && (frame[0] != ECHO_C || length != 2 + run->echo_size || frame[1] != run->echo_size)) {
+        run->errors++;
+      }
+      done++;
+      break;
+    }
+  }
+
+  memmove(run->pending, run->pending + done, (run->nr_of_pending - done) * sizeof(pending_t));
+  run->nr_of_pending -= done;
+}
+
+
+static int compare_uint64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+
+static double percentile_us(const run_t *run, double fraction) {
+
+  uint32_t index;
+
+  if (run->nr_of_latencies == 0) {
+    return 0.0;
+  }
+  index = (uint32_t)(fraction * (run->nr_of_latencies - 1) + 0.5);
+  return run->latency_ns[index] / 1000.0;
+}
+
+
+static void run_one(run_t *run) {
+
+  uint8_t  frame[FRAME_LENGTH_MAX_C + 2];
+  int32_t  length;
+  uint64_t start;
+  uint64_t stop;
+  double   seconds;
+
+  run->latency_ns = malloc(sizeof(uint64_t) * (opt_commands + 8));
+  link_rx_bytes   = 0;
+  link_tx_bytes   = 0;
+  start           = sim_time_ns();
+
+  while (1) {
+
+    // New periods are only started within the limits, so a run always ends
+    // with a command that has a reply
+    while (run->nr_of_pending < opt_window && run->sent < opt_commands &&
+           (sim_time_ns() - start) < opt_seconds * 1e9) {
+      run_period(run);
+    }
+    if (run->nr_of_pending == 0) {
+      break;
+    }
+
+    length = link_receive(frame, opt_timeout_ms, &run->errors);
+    if (length == 0) {
+      run->lost += run->nr_of_pending;
+      run->nr_of_pending = 0;
+      link_resync();
+      continue;
+    }
+    run_reply(run, frame, length);
+  }
+
+  stop    = sim_time_ns();
+  seconds = (stop - start) * 1e-9;
+  qsort(run->latency_ns, run->nr_of_latencies, sizeof(uint64_t), compare_uint64);
+
+  printf("{\"transport\": \"%s\", \"baud\": %u, \"crc\": %d, \"mix\": \"%s\", \"echo_bytes\": %d, "
+         "\"window\": %d, \"commands\": %u, \"lost\": %u, \"errors\": %u, \"seconds\": %.6f, "
+         "\"commands_per_s\": %.1f, \"payload_mb_per_s\": %.6f, \"host_to_board_bytes\": %llu, "
+         "\"board_to_host_bytes\": %llu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f}\n",
+         opt_port ? "serial" : "sim", run->baud_rate, run->crc, mix_names[run->mix],
+         (run->mix == MIX_ECHO_E || run->mix == MIX_MIXED_E) ? run->echo_size : 0,
+         opt_window, run->completed, run->lost, run->errors, seconds,
+         run->completed / seconds, run->payload_bytes / seconds / 1e6,
+         (unsigned long long)link_tx_bytes, (unsigned long long)link_rx_bytes,
+         percentile_us(run, 0.50), percentile_us(run, 0.99), percentile_us(run, 0.999));
+  fflush(stdout);
+
+  free(run->latency_ns);
+}
+
+
+static int32_t parse_list(const char *text, int32_t *list, int32_t max) {
+
+  int32_t n = 0;
+  char   *end;
+
+  while (*text && n < max) {
+    list[n++] = strtol(text, &end, 0);
+    text = (*end == ',') ? end + 1 : end;
+    if (end == text && *end != ',') {
+      break;
+    }
+  }
+  return n;
+}
+
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "%s [--port DEV] [--baud N] [--bauds N,...] [--crc 1,0] [--mix read,write,echo,mixed]\n"
+          "   [--sizes N,...] [--commands N] [--seconds S] [--window N] [--timeout-ms N]\n", name);
+  exit(1);
+}
+
+
+int main(int argc, char *argv[]) {
+
+  run_t   run = {0};
+  uint8_t frame[FRAME_LENGTH_MAX_C + 2];
+  int32_t list[BENCH_LIST_MAX_C];
+  int32_t n;
+  int32_t status = 0;
+
+  for (int32_t i = 1; i < argc; i++) {
+
+    const char *arg   = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+    if (value == NULL) {
+      usage(argv[0]);
+    }
+    i++;
+
+    if (!strcmp(arg, "--port")) {
+      opt_port = value;
+    } else if (!strcmp(arg, "--baud")) {
+      opt_baud = strtoul(value, NULL, 0);
+    } else if (!strcmp(arg, "--bauds")) {
+      n = parse_list(value, list, BENCH_LIST_MAX_C);
+      for (opt_nr_of_bauds = 0; opt_nr_of_bauds < n; opt_nr_of_bauds++) {
+        opt_bauds[opt_nr_of_bauds] = list[opt_nr_of_bauds];
+      }
+    } else if (!strcmp(arg, "--crc")) {
+      opt_nr_of_crcs = parse_list(value, opt_crcs, 2);
+    } else if (!strcmp(arg, "--mix")) {
+      for (n = 0; n < NR_OF_MIXES_E; n++) {
+        opt_mixes[n] = (strstr(value, mix_names[n]) != NULL);
+      }
+    } else if (!strcmp(arg, "--sizes")) {
+      opt_nr_of_sizes = parse_list(value, opt_sizes, BENCH_LIST_MAX_C);
+    } else if (!strcmp(arg, "--commands")) {
+      opt_commands = strtoul(value, NULL, 0);
+    } else if (!strcmp(arg, "--seconds")) {
+      opt_seconds = strtod(value, NULL);
+    } else if (!strcmp(arg, "--window")) {
+      opt_window = strtol(value, NULL, 0);
+    } else if (!strcmp(arg, "--timeout-ms")) {
+      opt_timeout_ms = strtol(value, NULL, 0);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if (opt_nr_of_bauds == 0) {
+    opt_bauds[opt_nr_of_bauds++] = opt_baud;
+  }
+  // A window holds whole periods of at most eight commands
+  if (opt_window < 1 || opt_window > BENCH_PENDING_MAX_C - 8) {
+    fprintf(stderr, "--window must be 1 to %d\n", BENCH_PENDING_MAX_C - 8);
+    return 1;
+  }
+  for (int32_t i = 0; i < opt_nr_of_sizes; i++) {
+    if (opt_sizes[i] < 0 || opt_sizes[i] > FRAME_LENGTH_MAX_C - 2) {
+      fprintf(stderr, "Echo sizes must be 0 to %d\n", FRAME_LENGTH_MAX_C - 2);
+      return 1;
+    }
+  }
+
+  if (link_open() != 0) {
+    return 1;
+  }
+
+  // A board may have been left without CRC by an earlier run
+  if (link_hello(frame) != 0) {
+    link_crc = !link_crc;
+    if (link_hello(frame) != 0) {
+      fprintf(stderr, "No HELLO from the board\n");
+      link_close();
+      return 1;
+    }
+  }
+  fprintf(stderr, "Protocol version %d, %u baud, CRC %d\n", frame[1], get_uint32(&frame[9]), frame[8]);
+
+  // The write mix writes the output gain with the value it already has
+  frame[0] = 'R'; frame[1] = 0; frame[2] = 0; frame[3] = 0; frame[4] = DAFX_MIXER_OUTPUT_GAIN_ADDR;
+  link_send(frame, 5);
+  if (link_receive(frame, opt_timeout_ms, &run.errors) > 0 && frame[0] == REGISTER_READ_C) {
+    gain = get_uint32(&frame[5]);
+  }
+
+  for (int32_t b = 0; b < opt_nr_of_bauds && status == 0; b++) {
+    for (int32_t c = 0; c < opt_nr_of_crcs && status == 0; c++) {
+
+      if (link_switch(opt_bauds[b], opt_crcs[c]) != 0) {
+        status = 1;
+        break;
+      }
+
+      for (int32_t m = 0; m < NR_OF_MIXES_E; m++) {
+
+        if (!opt_mixes[m]) {
+          continue;
+        }
+
+        n = (m == MIX_ECHO_E || m == MIX_MIXED_E) ? opt_nr_of_sizes : 1;
+        for (int32_t s = 0; s < n; s++) {
+          memset(&run, 0, sizeof(run));
+          run.baud_rate = opt_bauds[b];
+          run.crc       = opt_crcs[c];
+          run.mix       = m;
+          run.echo_size = opt_sizes[s];
+          run_one(&run);
+        }
+      }
+    }
+  }
+
+  // Leaves a real board as it was found
+  if (opt_port != NULL) {
+    link_switch(opt_baud, LINK_CRC_DEFAULT_C);
+  }
+
+  link_close();
+  return status;
+}
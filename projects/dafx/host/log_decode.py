@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+################################################################################
+#
+# Copyright (C) 2020 Fredrik Åkerlund
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Description:
+#   Decodes the binary LOG_C records of the DAFX firmware. The message strings
+#   and the frame type values are read from the firmware headers, so adding a
+#   log message needs no change here. The frame layouts are not, a new frame
+#   type must be added to frame_length().
+#
+#   ./log_decode.py capture.bin
+#   ./log_decode.py /dev/ttyUSB1 --baud 115200
+#
+################################################################################
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SW_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'sw')
+LEVELS = ['DEBUG', 'INFO', 'WARN', 'ERROR']
+CRLF   = (ord('\r'), ord('\n'))
+
+
+def read_defines(path):
+  defines = {}
+  with open(path) as f:
+    for line in f:
+      m = re.match(r'\s*#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|\d+)\s*$', line)
+      if m:
+        defines[m.group(1)] = int(m.group(2), 0)
+  return defines
+
+
+def read_messages(path):
+  messages = []
+  with open(path) as f:
+    for line in f:
+      m = re.match(r'\s*X\((\w+),\s*"(.*)"\)', line)
+      if m:
+        messages.append((m.group(1), m.group(2)))
+  return messages
+
+
+def format_message(fmt, args):
+  # The firmware sends all arguments as int32
+  values = []
+  for conv, value in zip(re.findall(r'%[-0-9]*([dux])', fmt), args):
+    values.append(value & 0xFFFFFFFF if conv in 'ux' else value)
+  try:
+    return fmt % tuple(values)
+  except (TypeError, ValueError):
+    return '%s %s' % (fmt, args)
+
+
+class Decoder:
+
+  def __init__(self, defines, messages, timer_hz):
+    self.defines  = defines
+    self.messages = messages
+    self.timer_hz = timer_hz
+    self.buffer   = bytearray()
+    self.last_ts  = None
+    self.wraps    = 0
+
+  def seconds(self, ts):
+    if self.last_ts is not None and self.last_ts - ts > 0x80000000:
+      self.wraps += 1
+    self.last_ts = ts
+    return ((self.wraps << 32) + ts) / self.timer_hz
+
+  def feed(self, data):
+    self.buffer += data
+    while self.buffer:
+      consumed = self.decode_one()
+      if consumed == 0:
+        break
+      del self.buffer[:consumed]
+
+  # Length of the frame at the start of the buffer, 0 if more data is needed
+  # and None for a type that is not in qhost_defines.h. Frames carry neither a
+  # sync word nor a length, so every type must be parsed to stay in sync.
+  def frame_length(self, b):
+    d = self.defines
+    t = b[0]
+    n = len(b)
+
+    fixed = {
+      d['REGISTER_READ_C']: 9,   # type, addr32, data32
+      d['PRESET_INFO_C']:   9,   # type, slot, valid, tag32, crc16
+      d['TX_STATS_C']:      22,  # type, stream, 4 x count32, used16, peak16
+      d['LINK_C']:          9,   # type, status, baud32, crc, frame max16
+    }
+    if t in fixed:
+      return fixed[t]
+    if t == d['LOG_C']:
+      return 8 + 4 * (b[7] & 0x0F) if n >= 8 else 0
+    if t == d['SAMPLE_BLOCK_C']:
+      # type, id, channels, n, int24 samples per channel
+      return 4 + 3 * b[3] * bin(b[2] & 0x03).count('1') if n >= 4 else 0
+    if t == d['CAPTURE_C']:
+      # type, seq, offset16, total16, pre16, n, int24 left and right
+      return 9 + 6 * b[8] if n >= 9 else 0
+    if t == d['SPECTRUM_C']:
+      # type, channel, size log2, flags, n, uint16 bins
+      return 5 + 2 * b[4] if n >= 5 else 0
+    if t == d['HELLO_C']:
+      return 14 + 4 * b[13] if n >= 14 else 0
+    if t == d['ECHO_C']:
+      return 2 + b[1] if n >= 2 else 0
+    if t == d['STRING_C']:
+      # xil_printf() text ends in "\n\r", the pair is part of the frame
+      for i in range(1, n):
+        if b[i] in CRLF:
+          if i + 1 < n and b[i + 1] in CRLF and b[i + 1] != b[i]:
+            return i + 2
+          return i + 1
+      return 0
+    return None
+
+  # Returns the number of consumed bytes, 0 if more data is needed
+  def decode_one(self):
+    b      = self.buffer
+    t      = b[0]
+    length = self.frame_length(b)
+
+    # The rest of a line ending split over two reads
+    if t in CRLF:
+      return 1
+    if length is None:
+      # Reported, not guessed: the bytes after it cannot be trusted
+      print('%12s %-5s Unknown frame type 0x%02X, the stream is out of sync' % ('', 'ERROR', t))
+      return 1
+    if length == 0 or len(b) < length:
+      return 0
+
+    if t == self.defines['LOG_C']:
+      ts, msg_id, level_args = struct.unpack('>IHB', b[1:8])
+      nr_of_args = level_args & 0x0F
+      args = list(struct.unpack('>%di' % nr_of_args, b[8:length]))
+      if msg_id < len(self.messages):
+        text = format_message(self.messages[msg_id][1], args)
+      else:
+        text = 'Unknown message id %d %s' % (msg_id, args)
+      level = LEVELS[level_args >> 4] if (level_args >> 4) < len(LEVELS) else '?'
+      print('%12.6f %-5s %s' % (self.seconds(ts), level, text))
+
+    elif t == self.defines['STRING_C']:
+      text = b[1:length].decode('ascii', 'replace').strip()
+      if text:
+        print('%12s %-5s %s' % ('', 'TEXT', text))
+
+    # Every other frame is skipped as a whole
+    return length
+
+
+def main():
+  parser = argparse.ArgumentParser(description='DAFX binary log decoder')
+  parser.add_argument('source', help='Capture file or serial port')
+  parser.add_argument('--baud', type=int, help='Open the source as a serial port at this rate')
+  parser.add_argument('--timer-hz', type=float, default=325e6, help='Global timer frequency of the Cortex-A9')
+  args = parser.parse_args()
+
+  defines  = read_defines(os.path.join(SW_DIR, 'qhost_defines.h'))
+  messages = read_messages(os.path.join(SW_DIR, 'log_messages.h'))
+  decoder  = Decoder(defines, messages, args.timer_hz)
+
+  if args.baud:
+    import serial
+    port = serial.Serial(args.source, args.baud, timeout=0.1)
+    while True:
+      decoder.feed(port.read(4096))
+  else:
+    with open(args.source, 'rb') as f:
+      decoder.feed(f.read())
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Runs the SPSC queue of the AMP build (sw/spsc_queue.h) between two
+//   threads. The producer sends frames of random length with a sequence
+//   number and a pattern, the consumer checks every byte and the order.
+//
+//   gcc -std=gnu11 -O2 -Wall -pthread -I../sw spsc_host.c -o spsc_host
+//   ./spsc_host [nr of frames] [queue size]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "spsc_queue.h"
+
+#define FRAME_MAX_C 256
+
+static spsc_queue_t queue;
+static uint32_t     nr_of_frames;
+static uint64_t     nr_of_bytes;
+static uint32_t     nr_of_errors;
+
+
+static uint32_t next_random(uint32_t *state) {
+  *state = *state * 1664525 + 1013904223;
+  return *state >> 8;
+}
+
+
+// Frame: sequence number (4) followed by bytes derived from it
+static int32_t make_frame(uint8_t *frame, uint32_t seq, uint32_t *state) {
+
+  int32_t length = 4 + next_random(state) % (FRAME_MAX_C - 4 + 1);
+
+  frame[0] = seq >> 24;
+  frame[1] = seq >> 16;
+  frame[2] = seq >> 8;
+  frame[3] = seq;
+  for (int32_t i = 4; i < length; i++) {
+    frame[i] = (uint8_t)(seq * 31 + i);
+  }
+  return length;
+}
+
+
+static void *producer(void *arg) {
+
+  uint8_t  frame[FRAME_MAX_C];
+  uint32_t state = 1;
+  int32_t  length;
+
+  for (uint32_t seq = 0; seq < nr_of_frames; seq++) {
+    length = make_frame(frame, seq, &state);
+    while (spsc_push(&queue, frame, length) != 0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+
+static void *consumer(void *arg) {
+
+  uint8_t  frame[FRAME_MAX_C];
+  uint8_t  expected[FRAME_MAX_C];
+  uint32_t state = 1;
+  int32_t  length;
+  int32_t  expected_length;
+
+  for (uint32_t seq = 0; seq < nr_of_frames; seq++) {
+
+    while ((length = spsc_pop(&queue, frame, FRAME_MAX_C)) == 0) {
+      sched_yield();
+    }
+
+    expected_length = make_frame(expected, seq, &state);
+    if (length != expected_length || memcmp(frame, expected, length) != 0) {
+      if (nr_of_errors++ < 10) {
+        fprintf(stderr, "Frame %u: length %d, expected %d\n", seq, length, expected_length);
+      }
+    }
+    nr_of_bytes += (length > 0) ? length : 0;
+  }
+  return NULL;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  pthread_t       threads[2];
+  struct timespec start;
+  struct timespec stop;
+  uint32_t        size;
+  uint8_t        *data;
+  double          seconds;
+
+  nr_of_frames = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+  size         = (argc > 2) ? strtoul(argv[2], NULL, 0) : 32768;
+
+  if (size == 0 || (size & (size - 1)) != 0 || size < FRAME_MAX_C + 2) {
+    fprintf(stderr, "The queue size must be a power of two of at least %d\n", FRAME_MAX_C + 2);
+    return 1;
+  }
+
+  data = aligned_alloc(SPSC_CACHE_LINE_C, size);
+  spsc_init(&queue, data, size);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_create(&threads[0], NULL, consumer, NULL);
+  pthread_create(&threads[1], NULL, producer, NULL);
+  pthread_join(threads[1], NULL);
+  pthread_join(threads[0], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9;
+  printf("frames %u bytes %llu errors %u peak %u seconds %.3f frames/s %.0f MB/s %.1f\n",
+         nr_of_frames, (unsigned long long)nr_of_bytes, nr_of_errors, queue.peak,
+         seconds, nr_of_frames / seconds, nr_of_bytes / seconds / 1e6);
+
+  free(data);
+  return (nr_of_errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,433 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   See xil_shim.h.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "xil_shim.h"
+
+#define SIM_FIFO_SIZE_C      64
+#define SIM_STALL_NS_C       2000 // A longer gap between UART accesses is the host running instead of the board
+#define SIM_OUT_SIZE_C       65536
+#define SIM_AXI_BASEADDR_C   0x43C00000
+#define SIM_AXI_SIZE_C       0x10000
+
+typedef struct {
+  int      fd;
+  uint32_t baud_rate;
+  uint8_t  threshold;
+  uint8_t  timeout;
+  uint32_t imr;
+
+  // Bytes read from the socket that are still "on the wire"
+  uint8_t  wire[SIM_OUT_SIZE_C];
+  int32_t  wire_rd;
+  int32_t  wire_wr;
+  uint64_t wire_seen_ns;  // When the bytes in 'wire' were read
+  uint64_t rx_done_ns;    // When the last received byte was complete
+  uint64_t update_ns;     // Last call of sim_uart_update()
+
+  uint8_t  rx_fifo[SIM_FIFO_SIZE_C];
+  uint32_t rx_rd;
+  uint32_t rx_wr;
+  uint32_t rx_overrun;    // XUARTPS_IXR_OVER, cleared by writing the ISR
+
+  uint8_t  tx_fifo[SIM_FIFO_SIZE_C];
+  uint64_t tx_start_ns[SIM_FIFO_SIZE_C];
+  uint32_t tx_rd;
+  uint32_t tx_wr;
+  uint64_t tx_free_ns;    // When the last written byte has been sent
+
+  // The byte in the shift register, XUARTPS_SR_TACTIVE
+  uint8_t  tx_shift;
+  uint64_t tx_shift_done_ns;
+  int32_t  tx_active;
+
+  // Sent bytes not yet accepted by the socket
+  uint8_t  out[SIM_OUT_SIZE_C];
+  int32_t  out_length;
+
+  // The handler connected to XPAR_XUARTPS_0_INTR
+  Xil_ExceptionHandler handler;
+  void                *handler_data;
+  int32_t              enabled;
+  int32_t              in_handler;
+} sim_uart_t;
+
+static sim_uart_t     uart = {.fd = -1, .baud_rate = 115200, .threshold = 32, .timeout = 8};
+static uint32_t       axi_regs[SIM_AXI_SIZE_C / 4];
+static XUartPs_Config uart_config = {XPAR_XUARTPS_0_DEVICE_ID, XPAR_XUARTPS_0_BASEADDR, XPAR_XUARTPS_0_UART_CLK_FREQ_HZ};
+static XScuGic_Config gic_config  = {XPAR_PS7_SCUGIC_0_DEVICE_ID, 0xF8F00100, 0xF8F01000};
+
+
+uint64_t sim_time_ns() {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// 8N1, i.e., ten bit periods per byte
+static uint64_t sim_byte_ns() {
+  return 10000000000ull / uart.baud_rate;
+}
+
+
+static void sim_uart_flush_out() {
+
+  ssize_t n;
+
+  if (uart.out_length == 0) {
+    return;
+  }
+
+  n = write(uart.fd, uart.out, uart.out_length);
+  if (n > 0) {
+    memmove(uart.out, uart.out + n, uart.out_length - n);
+    uart.out_length -= n;
+  }
+}
+
+
+static uint32_t sim_uart_isr();
+
+
+// Moves time forward: sent bytes move from the TX FIFO through the shift
+// register and received bytes enter the RX FIFO, both at the baud rate. A pending interrupt is then taken, so
+// the firmware is interrupted at its next UART access.
+static void sim_uart_update() {
+
+  uint64_t now = sim_time_ns();
+  uint64_t start;
+  ssize_t  n;
+
+  // The firmware reaches a UART access, and so the interrupt, well within
+  // SIM_STALL_NS_C. A longer gap is the board thread waiting for the core
+  // or a system call, so the wire is paused for it. Overruns are then caused
+  // by the firmware, e.g., by a handler that does not drain the RX FIFO.
+  if (uart.update_ns != 0 && now - uart.update_ns > SIM_STALL_NS_C) {
+    uart.wire_seen_ns += now - uart.update_ns;
+    uart.rx_done_ns   += now - uart.update_ns;
+  }
+  uart.update_ns = now;
+
+  while (1) {
+    if (uart.tx_active) {
+      if (uart.tx_shift_done_ns > now) {
+        break;
+      }
+      if (uart.out_length < SIM_OUT_SIZE_C) {
+        uart.out[uart.out_length++] = uart.tx_shift;
+      }
+      uart.tx_active = 0;
+    }
+    if (uart.tx_rd == uart.tx_wr || uart.tx_start_ns[uart.tx_rd % SIM_FIFO_SIZE_C] > now) {
+      break;
+    }
+    uart.tx_shift_done_ns = uart.tx_start_ns[uart.tx_rd % SIM_FIFO_SIZE_C] + sim_byte_ns();
+    uart.tx_shift         = uart.tx_fifo[uart.tx_rd++ % SIM_FIFO_SIZE_C];
+    uart.tx_active        = 1;
+  }
+  sim_uart_flush_out();
+
+  if (uart.wire_rd == uart.wire_wr) {
+    n = read(uart.fd, uart.wire, sizeof(uart.wire));
+    if (n > 0) {
+      uart.wire_rd      = 0;
+      uart.wire_wr      = n;
+      uart.wire_seen_ns = now;
+    }
+  }
+
+  while (uart.wire_rd != uart.wire_wr) {
+
+    start = (uart.rx_done_ns > uart.wire_seen_ns) ? uart.rx_done_ns : uart.wire_seen_ns;
+    if (start + sim_byte_ns() > now) {
+      break;
+    }
+
+    uart.rx_done_ns = start + sim_byte_ns();
+
+    // A byte received with a full FIFO is lost
+    if (uart.rx_wr - uart.rx_rd == SIM_FIFO_SIZE_C) {
+      uart.rx_overrun = XUARTPS_IXR_OVER;
+      uart.wire_rd++;
+      continue;
+    }
+
+    uart.rx_fifo[uart.rx_wr++ % SIM_FIFO_SIZE_C] = uart.wire[uart.wire_rd++];
+  }
+
+  if (uart.enabled && !uart.in_handler && (sim_uart_isr() & uart.imr)) {
+    uart.in_handler = 1;
+    uart.handler(uart.handler_data);
+    uart.in_handler = 0;
+  }
+}
+
+
+static uint32_t sim_uart_isr() {
+
+  uint32_t level = uart.rx_wr - uart.rx_rd;
+  uint32_t isr   = uart.rx_overrun;
+
+  if (level >= uart.threshold) {
+    isr |= XUARTPS_IXR_RXOVR;
+  }
+  if (level == SIM_FIFO_SIZE_C) {
+    isr |= XUARTPS_IXR_RXFULL;
+  }
+  // The timeout counts in units of four bit periods
+  if (level > 0 && sim_time_ns() - uart.rx_done_ns >= uart.timeout * 4 * sim_byte_ns() / 10) {
+    isr |= XUARTPS_IXR_TOUT;
+  }
+  return isr;
+}
+
+
+void sim_uart_attach(int fd) {
+  uart.fd = fd;
+}
+
+
+void sim_uart_poll() {
+  sim_uart_update();
+}
+
+
+u32 Xil_In32(u32 addr) {
+
+  uint32_t sr = 0;
+  XTime    now;
+
+  if (addr >= XPAR_XUARTPS_0_BASEADDR && addr < XPAR_XUARTPS_0_BASEADDR + 0x1000) {
+
+    sim_uart_update();
+
+    switch (addr - XPAR_XUARTPS_0_BASEADDR) {
+      case XUARTPS_SR_OFFSET:
+        sr |= (uart.rx_rd == uart.rx_wr)                  ? XUARTPS_SR_RXEMPTY : 0;
+        sr |= (uart.rx_wr - uart.rx_rd == SIM_FIFO_SIZE_C) ? XUARTPS_SR_RXFULL  : 0;
+        sr |= (uart.tx_rd == uart.tx_wr)                  ? XUARTPS_SR_TXEMPTY : 0;
+        sr |= (uart.tx_wr - uart.tx_rd == SIM_FIFO_SIZE_C) ? XUARTPS_SR_TXFULL  : 0;
+        sr |= uart.tx_active                               ? XUARTPS_SR_TACTIVE : 0;
+        return sr;
+      case XUARTPS_FIFO_OFFSET:
+        return (uart.rx_rd != uart.rx_wr) ? uart.rx_fifo[uart.rx_rd++ % SIM_FIFO_SIZE_C] : 0;
+      case XUARTPS_ISR_OFFSET:
+        return sim_uart_isr();
+      case XUARTPS_IMR_OFFSET:
+        return uart.imr;
+      default:
+        return 0;
+    }
+  }
+
+  if (addr == GLOBAL_TMR_BASEADDR + GTIMER_COUNTER_LOWER_OFFSET) {
+    XTime_GetTime(&now);
+    return (u32)now;
+  }
+
+  if (addr >= SIM_AXI_BASEADDR_C && addr < SIM_AXI_BASEADDR_C + SIM_AXI_SIZE_C) {
+    return axi_regs[(addr - SIM_AXI_BASEADDR_C) / 4];
+  }
+
+  return 0;
+}
+
+
+void Xil_Out32(u32 addr, u32 value) {
+
+  uint64_t start;
+
+  if (addr == XPAR_XUARTPS_0_BASEADDR + XUARTPS_FIFO_OFFSET) {
+    sim_uart_update();
+    // Writes to a full FIFO are lost, as on the hardware
+    if (uart.tx_wr - uart.tx_rd < SIM_FIFO_SIZE_C) {
+      start = sim_time_ns();
+      if (uart.tx_free_ns > start) {
+        start = uart.tx_free_ns;
+      }
+      uart.tx_free_ns                                = start + sim_byte_ns();
+      uart.tx_start_ns[uart.tx_wr % SIM_FIFO_SIZE_C] = start;
+      uart.tx_fifo[uart.tx_wr++ % SIM_FIFO_SIZE_C]   = (uint8_t)value;
+    }
+    return;
+  }
+
+  // Only the overrun bit is sticky, the FIFO bits follow the FIFO level
+  if (addr == XPAR_XUARTPS_0_BASEADDR + XUARTPS_ISR_OFFSET) {
+    uart.rx_overrun &= ~value;
+    return;
+  }
+
+  if (addr >= SIM_AXI_BASEADDR_C && addr < SIM_AXI_BASEADDR_C + SIM_AXI_SIZE_C) {
+    axi_regs[(addr - SIM_AXI_BASEADDR_C) / 4] = value;
+  }
+}
+
+
+// Goes out on the UART like the BSP's outbyte()
+void xil_printf(const char *format, ...) {
+
+  char    text[256];
+  va_list args;
+  int32_t length;
+
+  va_start(args, format);
+  length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+
+  if (uart.fd < 0) {
+    return;
+  }
+
+  for (int32_t i = 0; i < length && i < (int32_t)sizeof(text) - 1; i++) {
+    while (XUartPs_IsTransmitFull(XPAR_XUARTPS_0_BASEADDR));
+    Xil_Out32(XPAR_XUARTPS_0_BASEADDR + XUARTPS_FIFO_OFFSET, (uint8_t)text[i]);
+  }
+}
+
+
+void XTime_GetTime(XTime *time) {
+  *time = sim_time_ns() * (COUNTS_PER_SECOND / 1000000) / 1000;
+}
+
+
+void Xil_SetTlbAttributes(u32 addr, u32 attrib) {
+}
+
+
+void Xil_ExceptionInit() {
+}
+
+
+void Xil_ExceptionRegisterHandler(u32 id, Xil_ExceptionHandler handler, void *data) {
+}
+
+
+void Xil_ExceptionEnable() {
+}
+
+
+XScuGic_Config *XScuGic_LookupConfig(u16 device_id) {
+  return &gic_config;
+}
+
+
+s32 XScuGic_CfgInitialize(XScuGic *gic, XScuGic_Config *config, u32 base_address) {
+  gic->Config = *config;
+  return XST_SUCCESS;
+}
+
+
+s32 XScuGic_Connect(XScuGic *gic, u32 id, Xil_ExceptionHandler handler, void *data) {
+  if (id == XPAR_XUARTPS_0_INTR) {
+    uart.handler      = handler;
+    uart.handler_data = data;
+  }
+  return XST_SUCCESS;
+}
+
+
+void XScuGic_SetPriorityTriggerType(XScuGic *gic, u32 id, u8 priority, u8 trigger) {
+}
+
+
+void XScuGic_Enable(XScuGic *gic, u32 id) {
+  if (id == XPAR_XUARTPS_0_INTR && uart.handler != NULL) {
+    uart.enabled = 1;
+  }
+}
+
+
+void XScuGic_InterruptMaptoCpu(XScuGic *gic, u8 cpu, u32 id) {
+}
+
+
+void XScuGic_InterruptUnmapFromCpu(XScuGic *gic, u8 cpu, u32 id) {
+}
+
+
+void XScuGic_InterruptHandler(void *data) {
+}
+
+
+XUartPs_Config *XUartPs_LookupConfig(u16 device_id) {
+  return &uart_config;
+}
+
+
+s32 XUartPs_CfgInitialize(XUartPs *instance, XUartPs_Config *config, u32 base_address) {
+  instance->Config             = *config;
+  instance->Config.BaseAddress = base_address;
+  instance->BaudRate           = uart.baud_rate;
+  return XST_SUCCESS;
+}
+
+
+s32 XUartPs_SelfTest(XUartPs *instance) {
+  return XST_SUCCESS;
+}
+
+
+void XUartPs_SetOperMode(XUartPs *instance, u8 mode) {
+}
+
+
+s32 XUartPs_SetBaudRate(XUartPs *instance, u32 baud_rate) {
+
+  if (baud_rate == 0) {
+    return XST_FAILURE;
+  }
+
+  // The BSP resets the TX and RX paths, the bytes in the FIFOs and the shift
+  // register are lost
+  sim_uart_update();
+  uart.tx_rd      = uart.tx_wr;
+  uart.tx_active  = 0;
+  uart.tx_free_ns = 0;
+  uart.rx_rd      = uart.rx_wr;
+
+  uart.baud_rate     = baud_rate;
+  instance->BaudRate = baud_rate;
+  return XST_SUCCESS;
+}
+
+
+void XUartPs_SetFifoThreshold(XUartPs *instance, u8 threshold) {
+  uart.threshold = threshold;
+}
+
+
+void XUartPs_SetRecvTimeout(XUartPs *instance, u8 timeout) {
+  uart.timeout = timeout;
+}
+
+
+void XUartPs_SetInterruptMask(XUartPs *instance, u32 mask) {
+  uart.imr = mask;
+}
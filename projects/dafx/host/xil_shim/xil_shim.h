@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Host build of the firmware for host/link_bench.c. Declares the parts of
+//   the Xilinx standalone BSP the firmware uses; the BSP header names (xil_io.h,
+//   xuartps.h, ...) only include this file.
+//
+//   The PS UART is simulated at the register level: bytes from the attached
+//   socket arrive in the 64 byte RX FIFO at the configured baud rate and the
+//   TX FIFO drains into the socket at the same rate. The byte being shifted
+//   out sets XUARTPS_SR_TACTIVE, and XUartPs_SetBaudRate() loses whatever is
+//   still in the FIFOs or the shift register, as on the hardware. The RX FIFO
+//   trigger, timeout and overrun interrupts call the handler connected to the
+//   UART at the firmware's next UART register access or sim_uart_poll(). A
+//   byte that arrives at a full RX FIFO is lost and sets XUARTPS_IXR_OVER
+//   until the ISR bit is written, as on the hardware. The wire is paused while
+//   the host has descheduled the board thread, which the firmware never is.
+//   AXI registers are plain memory.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_SHIM_H
+#define XIL_SHIM_H
+
+#include <stdint.h>
+
+// xil_types.h, xstatus.h
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+
+#define XST_SUCCESS 0
+#define XST_FAILURE 1
+
+// xparameters.h
+#define XPAR_CPU_ID                             0
+#define XPAR_PS7_SCUGIC_0_DEVICE_ID             0
+#define XPAR_XUARTPS_0_DEVICE_ID                0
+#define XPAR_XUARTPS_0_BASEADDR                 0xE0000000
+#define XPAR_XUARTPS_0_UART_CLK_FREQ_HZ         100000000
+#define XPAR_XUARTPS_0_INTR                     82
+#define XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR 62
+
+// xil_io.h, xil_printf.h, xil_mmu.h
+u32  Xil_In32(u32 addr);
+void Xil_Out32(u32 addr, u32 value);
+void xil_printf(const char *format, ...);
+void Xil_SetTlbAttributes(u32 addr, u32 attrib);
+
+// xil_exception.h
+typedef void (*Xil_ExceptionHandler)(void *data);
+
+#define XIL_EXCEPTION_ID_INT 5
+
+void Xil_ExceptionInit();
+void Xil_ExceptionRegisterHandler(u32 id, Xil_ExceptionHandler handler, void *data);
+void Xil_ExceptionEnable();
+
+// xscugic.h
+typedef struct {
+  u16 DeviceId;
+  u32 CpuBaseAddress;
+  u32 DistBaseAddress;
+} XScuGic_Config;
+
+typedef struct {
+  XScuGic_Config Config;
+} XScuGic;
+
+XScuGic_Config *XScuGic_LookupConfig(u16 device_id);
+s32             XScuGic_CfgInitialize(XScuGic *gic, XScuGic_Config *config, u32 base_address);
+s32             XScuGic_Connect(XScuGic *gic, u32 id, Xil_ExceptionHandler handler, void *data);
+void            XScuGic_SetPriorityTriggerType(XScuGic *gic, u32 id, u8 priority, u8 trigger);
+void            XScuGic_Enable(XScuGic *gic, u32 id);
+void            XScuGic_InterruptMaptoCpu(XScuGic *gic, u8 cpu, u32 id);
+void            XScuGic_InterruptUnmapFromCpu(XScuGic *gic, u8 cpu, u32 id);
+void            XScuGic_InterruptHandler(void *data);
+
+// xtime_l.h
+typedef u64 XTime;
+
+#define COUNTS_PER_SECOND           325000000
+#define GLOBAL_TMR_BASEADDR         0xF8F00200
+#define GTIMER_COUNTER_LOWER_OFFSET 0x00
+#define GTIMER_COUNTER_UPPER_OFFSET 0x04
+
+void XTime_GetTime(XTime *time);
+
+// xuartps.h
+typedef struct {
+  u16 DeviceId;
+  u32 BaseAddress;
+  u32 InputClockHz;
+} XUartPs_Config;
+
+typedef struct {
+  XUartPs_Config Config;
+  u32            BaudRate;
+} XUartPs;
+
+#define XUARTPS_OPER_MODE_NORMAL 0x00
+#define XUARTPS_IMR_OFFSET       0x10
+#define XUARTPS_ISR_OFFSET       0x14
+#define XUARTPS_SR_OFFSET        0x2C
+#define XUARTPS_FIFO_OFFSET      0x30
+#define XUARTPS_IXR_RXOVR        0x0001
+#define XUARTPS_IXR_RXFULL       0x0004
+#define XUARTPS_IXR_OVER         0x0020
+#define XUARTPS_IXR_TOUT         0x0100
+#define XUARTPS_SR_RXEMPTY       0x0002
+#define XUARTPS_SR_RXFULL        0x0004
+#define XUARTPS_SR_TXEMPTY       0x0008
+#define XUARTPS_SR_TXFULL        0x0010
+#define XUARTPS_SR_TACTIVE       0x0800
+
+#define XUartPs_ReadReg(base, offset)        Xil_In32((base) + (offset))
+#define XUartPs_WriteReg(base, offset, data) Xil_Out32((base) + (offset), (data))
+#define XUartPs_IsReceiveData(base)          (!(Xil_In32((base) + XUARTPS_SR_OFFSET) & XUARTPS_SR_RXEMPTY))
+#define XUartPs_IsTransmitFull(base)         ((Xil_In32((base) + XUARTPS_SR_OFFSET) & XUARTPS_SR_TXFULL) != 0)
+#define XUartPs_IsTransmitEmpty(uart)        ((Xil_In32((uart)->Config.BaseAddress + XUARTPS_SR_OFFSET) & XUARTPS_SR_TXEMPTY) != 0)
+
+XUartPs_Config *XUartPs_LookupConfig(u16 device_id);
+s32             XUartPs_CfgInitialize(XUartPs *uart, XUartPs_Config *config, u32 base_address);
+s32             XUartPs_SelfTest(XUartPs *uart);
+void            XUartPs_SetOperMode(XUartPs *uart, u8 mode);
+s32             XUartPs_SetBaudRate(XUartPs *uart, u32 baud_rate);
+void            XUartPs_SetFifoThreshold(XUartPs *uart, u8 threshold);
+void            XUartPs_SetRecvTimeout(XUartPs *uart, u8 timeout);
+void            XUartPs_SetInterruptMask(XUartPs *uart, u32 mask);
+
+// Simulation
+void     sim_uart_attach(int fd);
+void     sim_uart_poll();
+uint64_t sim_time_ns();
+
+#endif
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   The two ends of the shared OCM queues, see amp.h.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "xil_mmu.h"
+#include "xil_printf.h"
+#include "xtime_l.h"
+#include "xstatus.h"
+#include "qhost_defines.h"
+#include "cmd_table.h"
+#include "log_ring.h"
+#include "tx_mux.h"
+#include "amp.h"
+
+#if defined(__arm__)
+  #define AMP_SEV() __asm__ volatile ("dsb\n\tsev" ::: "memory")
+  #define AMP_WFE() __asm__ volatile ("wfe")
+#else
+  #define AMP_SEV()
+  #define AMP_WFE()
+#endif
+
+static uint8_t amp_frame[FRAME_LENGTH_MAX_C];
+
+// CPU0: set once CPU1 has reported ready, commands are not queued before that
+static uint8_t amp_rt_running = 0;
+
+
+// Both cores have their own translation table, so both mark the shared
+// section as not cacheable before touching it
+static void amp_init_memory() {
+  Xil_SetTlbAttributes(AMP_SHARED_BASE_C, AMP_SHARED_TLB_ATTR_C);
+}
+
+
+// Sets up the queues and releases CPU1 from the boot ROM. Called after the GIC
+// distributor has been initialized, CPU1 only connects its own interrupts.
+int32_t amp_start_rt() {
+
+  XTime start;
+  XTime now;
+
+  amp_init_memory();
+
+  amp_shared->rt_ready = 0;
+  spsc_init(&amp_shared->link_to_rt, amp_shared->link_to_rt_data, AMP_LINK_TO_RT_SIZE_C);
+#define AMP_RT_TO_LINK_INIT(stream, queue_size, quantum, rate, policy, decimation) \
+  spsc_init(&amp_shared->rt_to_link[stream], amp_shared->stream##_data, AMP_RT_TO_LINK_SCALE_C * (queue_size));
+  TX_STREAMS(AMP_RT_TO_LINK_INIT)
+#undef AMP_RT_TO_LINK_INIT
+  __atomic_store_n(&amp_shared->link_ready, AMP_READY_MAGIC_C, __ATOMIC_RELEASE);
+
+  Xil_Out32(AMP_CPU1_START_REG_C, AMP_CPU1_ENTRY_C);
+  AMP_SEV();
+
+  XTime_GetTime(&start);
+  do {
+    if (__atomic_load_n(&amp_shared->rt_ready, __ATOMIC_ACQUIRE) == AMP_READY_MAGIC_C) {
+      xil_printf("%cINFO [amp] CPU1 running\n", STR_C);
+      amp_rt_running = 1;
+      return XST_SUCCESS;
+    }
+    XTime_GetTime(&now);
+  } while (now - start < (XTime)COUNTS_PER_SECOND / 1000 * AMP_START_TIMEOUT_MS_C);
+
+  xil_printf("%cERROR [amp] CPU1 did not start\n", STR_C);
+  return XST_FAILURE;
+}
+
+
+// Returns 0 if the command was queued for CPU1, -1 if the queue was full or
+// CPU1 is not running
+int32_t amp_forward_cmd(const uint8_t *buffer, int32_t length) {
+
+  if (!amp_rt_running) {
+    return -1;
+  }
+
+  if (spsc_push(&amp_shared->link_to_rt, buffer, length) != 0) {
+    LOG_WARN(LOG_AMP_CMD_DROPPED_E, buffer[0]);
+    return -1;
+  }
+  return 0;
+}
+
+
+// Moves CPU1's frames to the TX multiplexer. A frame stays in its stream's
+// shared queue until the stream has room, so CPU1 sees the same back pressure
+// through amp_forward_free() as it would from tx_mux_free(). A full stream
+// only holds up its own queue.
+void amp_poll_link() {
+
+  spsc_queue_t *q;
+  uint8_t       type;
+  int32_t       length;
+
+  for (int32_t stream = 0; stream < TX_NR_OF_STREAMS_E; stream++) {
+
+    q = &amp_shared->rt_to_link[stream];
+
+    for (int32_t i = 0; i < AMP_POLL_FRAMES_C; i++) {
+
+      length = spsc_peek(q, &type);
+      if (length == 0 || tx_mux_free(type) < length) {
+        break;
+      }
+
+      length = spsc_pop(q, amp_frame, FRAME_LENGTH_MAX_C);
+      if (length > 0) {
+        tx_mux_send(amp_frame, length);
+      }
+    }
+  }
+}
+
+
+// Waits until CPU0 has set up the shared memory
+void amp_wait_link() {
+
+  amp_init_memory();
+
+  while (__atomic_load_n(&amp_shared->link_ready, __ATOMIC_ACQUIRE) != AMP_READY_MAGIC_C) {
+    AMP_WFE();
+  }
+}
+
+
+// Tells CPU0 that CPU1 is initialized and services its interrupts
+void amp_signal_ready() {
+  __atomic_store_n(&amp_shared->rt_ready, AMP_READY_MAGIC_C, __ATOMIC_RELEASE);
+}
+
+
+// Used instead of tx_mux_send() on CPU1. Drops are counted in the queue.
+int32_t amp_forward_frame(const uint8_t *buffer, int32_t length) {
+  return spsc_push(&amp_shared->rt_to_link[tx_mux_stream(buffer[0])], buffer, length);
+}
+
+
+int32_t amp_forward_free(uint8_t type) {
+  return spsc_free(&amp_shared->rt_to_link[tx_mux_stream(type)]);
+}
+
+
+// Executes the commands forwarded by CPU0
+void amp_poll_rt() {
+
+  int32_t length;
+
+  for (int32_t i = 0; i < AMP_POLL_FRAMES_C; i++) {
+
+    length = spsc_pop(&amp_shared->link_to_rt, amp_frame, FRAME_LENGTH_MAX_C);
+    if (length == 0) {
+      return;
+    }
+    if (length > 0) {
+      cmd_dispatch(amp_frame, length, CMD_CTX_MAIN_C);
+    }
+  }
+}
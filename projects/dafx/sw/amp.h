@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Asymmetric multiprocessing. Built with DAFX_AMP defined, the same sources
+//   make two applications: CPU0 owns the link (UART RX/TX, the protocol and
+//   the AXI register commands) and CPU1 owns the real-time side (irq_1, the
+//   presets, the sample stream, the capture and the spectrum). Without
+//   DAFX_AMP everything runs on CPU0 as before.
+//
+//   The cores only share SPSC queues in the upper OCM. Commands flagged
+//   CMD_RT_C are forwarded to CPU1, and every frame CPU1 sends to the host is
+//   forwarded back to CPU0's TX multiplexer through a queue per TX stream, so
+//   a stream that is over its budget does not hold up the others. Protocol
+//   traffic can never delay irq_1, which is routed to CPU1 only.
+//
+//   The CPU1 application's BSP must be built with USE_AMP=1, so that it does
+//   not reset the GIC distributor set up by CPU0, and without a stdout.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef AMP_H
+#define AMP_H
+
+#include <stdint.h>
+#include "xparameters.h"
+#include "spsc_queue.h"
+#include "tx_mux.h"
+
+#if defined(DAFX_AMP) && XPAR_CPU_ID == 0
+  #define AMP_LINK_CORE_C 1
+#else
+  #define AMP_LINK_CORE_C 0
+#endif
+
+#if defined(DAFX_AMP) && XPAR_CPU_ID == 1
+  #define AMP_RT_CORE_C 1
+#else
+  #define AMP_RT_CORE_C 0
+#endif
+
+#define AMP_SHARED_BASE_C      0xFFFF0000 // Upper OCM, same address on both cores
+#define AMP_SHARED_TLB_ATTR_C  0x14DE2    // Shareable normal memory, not cacheable
+#define AMP_CPU1_START_REG_C   0xFFFFFFF0 // Read by CPU1's boot ROM wait loop after a sev
+#ifndef AMP_CPU1_ENTRY_C
+  #define AMP_CPU1_ENTRY_C     0x10000000 // Start of CPU1's application, see its linker script
+#endif
+#define AMP_READY_MAGIC_C      0x44414658 // "DAFX"
+#define AMP_START_TIMEOUT_MS_C 1000
+
+#define AMP_LINK_TO_RT_SIZE_C  4096  // Must be a power of two
+#define AMP_RT_TO_LINK_SCALE_C 4     // Size of a stream's frame queue in its TX queue sizes, a power of two
+#define AMP_POLL_FRAMES_C      8     // Frames moved per call and queue of the poll functions
+
+#define AMP_RT_TO_LINK_DATA(stream, queue_size, quantum, rate, policy, decimation) \
+  uint8_t stream##_data[AMP_RT_TO_LINK_SCALE_C * (queue_size)];
+
+typedef struct {
+  spsc_queue_t      link_to_rt;                     // Commands, produced by CPU0
+  spsc_queue_t      rt_to_link[TX_NR_OF_STREAMS_E]; // Frames for the host per TX stream, produced by CPU1
+  volatile uint32_t link_ready;
+  volatile uint32_t rt_ready;
+  uint8_t           link_to_rt_data[AMP_LINK_TO_RT_SIZE_C];
+  TX_STREAMS(AMP_RT_TO_LINK_DATA)
+} amp_shared_t;
+
+// The boot ROM uses the last 512 bytes of the OCM
+_Static_assert(sizeof(amp_shared_t) <= 0x10000 - 0x200, "amp_shared_t does not fit in the upper OCM");
+_Static_assert((AMP_LINK_TO_RT_SIZE_C & (AMP_LINK_TO_RT_SIZE_C - 1)) == 0, "AMP_LINK_TO_RT_SIZE_C must be a power of two");
+_Static_assert((AMP_RT_TO_LINK_SCALE_C & (AMP_RT_TO_LINK_SCALE_C - 1)) == 0, "AMP_RT_TO_LINK_SCALE_C must be a power of two");
+
+#define amp_shared ((amp_shared_t *)AMP_SHARED_BASE_C)
+
+// CPU0
+int32_t amp_start_rt();
+int32_t amp_forward_cmd(const uint8_t *buffer, int32_t length);
+void    amp_poll_link();
+
+// CPU1
+void    amp_wait_link();
+void    amp_signal_ready();
+int32_t amp_forward_frame(const uint8_t *buffer, int32_t length);
+int32_t amp_forward_free(uint8_t type);
+void    amp_poll_rt();
+
+#endif
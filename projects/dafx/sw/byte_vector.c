@@ -33,6 +33,12 @@ void vector_append_uint16(uint8_t* vector, uint16_t number, int32_t *index) {
   vector[(*index)++] = number;
 }
 
+void vector_append_int24(uint8_t* vector, int32_t number, int32_t *index) {
+  vector[(*index)++] = number >> 16;
+  vector[(*index)++] = number >> 8;
+  vector[(*index)++] = number;
+}
+
 void vector_append_int32(uint8_t* vector, int32_t number, int32_t *index) {
   vector[(*index)++] = number >> 24;
   vector[(*index)++] = number >> 16;
@@ -88,6 +94,14 @@ uint16_t vector_get_uint16(const uint8_t *vector, int32_t *index) {
   return _uint16;
 }
 
+int32_t vector_get_int24(const uint8_t *vector, int32_t *index) {
+  int32_t _int24 = ((uint32_t) vector[*index])     << 24 |
+                   ((uint32_t) vector[*index + 1]) << 16 |
+                   ((uint32_t) vector[*index + 2]) << 8;
+  *index += 3;
+  return _int24 >> 8;
+}
+
 int32_t vector_get_int32(const uint8_t *vector, int32_t *index) {
   int32_t _int32 = ((uint32_t) vector[*index])     << 24 |
                    ((uint32_t) vector[*index + 1]) << 16 |
@@ -26,10 +26,12 @@
 
 void     vector_append_int16        (uint8_t*       vector, int16_t  number, int32_t *index);
 void     vector_append_uint16       (uint8_t*       vector, uint16_t number, int32_t *index);
+void     vector_append_int24        (uint8_t*       vector, int32_t  number, int32_t *index);
 void     vector_append_int32        (uint8_t*       vector, int32_t  number, int32_t *index);
 void     vector_append_uint32       (uint8_t*       vector, uint32_t number, int32_t *index);
 int16_t  vector_get_int16           (const uint8_t *vector, int32_t *index);
 uint16_t vector_get_uint16          (const uint8_t *vector, int32_t *index);
+int32_t  vector_get_int24           (const uint8_t *vector, int32_t *index);
 int32_t  vector_get_int32           (const uint8_t *vector, int32_t *index);
 uint32_t vector_get_uint32          (const uint8_t *vector, int32_t *index);
 
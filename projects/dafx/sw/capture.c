@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Triggered capture, see capture.h.
+//
+//   'O' mode trigger channel level pre post timeout
+//         Configures and arms the capture. 'level' is int32, 'pre', 'post' and
+//         the auto mode 'timeout' are uint16 in samples; pre + post must fit
+//         in CAPTURE_SIZE_C. 'channel' is SAMPLE_CHANNEL_LEFT_C or _RIGHT_C.
+//   'F'   Forces a trigger
+//
+//   Frame: type, sequence number, offset (2), total (2), pre (2), n, then n
+//   stereo samples of signed 24 bit, left before right.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "byte_vector.h"
+#include "dafx_address.h"
+#include "dafx_axi.h"
+#include "qhost_defines.h"
+#include "tx_mux.h"
+#include "sample_stream.h"
+#include "capture.h"
+
+#define CAPTURE_FRAME_MAX_C (9 + 6 * CAPTURE_CHUNK_SIZE_C)
+
+static   int32_t           capture_left[CAPTURE_SIZE_C];
+static   int32_t           capture_right[CAPTURE_SIZE_C];
+volatile capture_state_t   capture_state;
+static   capture_mode_t    capture_mode;
+static   capture_trigger_t capture_trigger;
+static   uint8_t           capture_channel;
+static   int32_t           capture_level;
+static   uint32_t          capture_pre;
+static   uint32_t          capture_post;
+static   uint32_t          capture_auto_timeout;
+volatile uint8_t           capture_forced;
+
+// Written by the irq_1 handler
+static   uint32_t          capture_wr_addr;
+static   uint32_t          capture_filled;
+static   uint32_t          capture_armed_ticks;
+static   uint32_t          capture_end_addr;
+static   int32_t           capture_previous;
+
+// Written by the main loop
+static   uint8_t           capture_seq;
+static   uint32_t          capture_tx_offset;
+static   uint8_t           capture_tx_buffer[CAPTURE_FRAME_MAX_C];
+
+
+void capture_init() {
+  capture_state = CAPTURE_IDLE_E;
+  capture_mode  = CAPTURE_OFF_E;
+  capture_seq   = 0;
+}
+
+
+static void capture_arm() {
+
+  capture_filled      = 0;
+  capture_armed_ticks = 0;
+  capture_forced      = 0;
+  capture_tx_offset   = 0;
+
+  if (capture_trigger == CAPTURE_TRIG_AMPLITUDE_E) {
+    axi_write(FPGA_BASEADDR, DAFX_CLEAR_ADC_AMPLITUDE_ADDR, 1);
+  }
+
+  capture_state = CAPTURE_ARMED_E;
+}
+
+
+static int32_t capture_triggered(int32_t sample) {
+
+  int32_t max;
+  int32_t min;
+
+  switch (capture_trigger) {
+
+    case CAPTURE_TRIG_RISING_E:
+      return capture_previous < capture_level && sample >= capture_level;
+
+    case CAPTURE_TRIG_FALLING_E:
+      return capture_previous > capture_level && sample <= capture_level;
+
+    case CAPTURE_TRIG_AMPLITUDE_E:
+      max = sample_sign_extend(axi_read(FPGA_BASEADDR, DAFX_CIR_MAX_DAC_AMPLITUDE_ADDR));
+      // project_top negates the minimum before the register file, so the
+      // register holds the magnitude of the most negative sample
+      min = sample_sign_extend(axi_read(FPGA_BASEADDR, DAFX_CIR_MIN_DAC_AMPLITUDE_ADDR));
+      return max >= capture_level || min >= capture_level;
+
+    default:
+      return 0;
+  }
+}
+
+
+// Called from the irq_1 handler
+void capture_push(int32_t left, int32_t right) {
+
+  capture_state_t state   = capture_state;
+  uint32_t        wr_addr = capture_wr_addr;
+  int32_t         sample;
+  int32_t         triggered;
+
+  if (state != CAPTURE_ARMED_E && state != CAPTURE_POST_E) {
+    return;
+  }
+
+  capture_left[wr_addr & (CAPTURE_SIZE_C - 1)]  = left;
+  capture_right[wr_addr & (CAPTURE_SIZE_C - 1)] = right;
+  capture_wr_addr = ++wr_addr;
+
+  if (state == CAPTURE_ARMED_E) {
+
+    sample = (capture_channel == SAMPLE_CHANNEL_RIGHT_C) ? right : left;
+
+    // The trigger is not evaluated until the pre-trigger part is filled, and
+    // never on the first sample, which only seeds capture_previous
+    if (capture_filled < capture_pre || capture_filled == 0) {
+      capture_filled++;
+      capture_previous = sample;
+      return;
+    }
+
+    triggered        = capture_forced || capture_triggered(sample);
+    capture_previous = sample;
+
+    if (capture_mode == CAPTURE_AUTO_E && ++capture_armed_ticks >= capture_auto_timeout) {
+      triggered = 1;
+    }
+
+    if (!triggered) {
+      return;
+    }
+
+    // The trigger sample is the first post-trigger sample
+    capture_end_addr = wr_addr - 1 + capture_post;
+    state            = CAPTURE_POST_E;
+  }
+
+  if (wr_addr == capture_end_addr) {
+    capture_state = CAPTURE_DONE_E;
+  } else {
+    capture_state = state;
+  }
+}
+
+
+// Called from the main loop, sends one chunk of a completed capture
+void capture_poll() {
+
+  uint32_t total = capture_pre + capture_post;
+  uint32_t start;
+  uint32_t addr;
+  int32_t  index = 0;
+  int32_t  length;
+
+  if (capture_state != CAPTURE_DONE_E || tx_mux_free(CAPTURE_C) < CAPTURE_FRAME_MAX_C) {
+    return;
+  }
+
+  start  = capture_end_addr - total;
+  length = total - capture_tx_offset;
+  if (length > CAPTURE_CHUNK_SIZE_C) {
+    length = CAPTURE_CHUNK_SIZE_C;
+  }
+
+  capture_tx_buffer[index++] = CAPTURE_C;
+  capture_tx_buffer[index++] = capture_seq;
+  vector_append_uint16(capture_tx_buffer, capture_tx_offset, &index);
+  vector_append_uint16(capture_tx_buffer, total,             &index);
+  vector_append_uint16(capture_tx_buffer, capture_pre,       &index);
+  capture_tx_buffer[index++] = length;
+
+  for (int32_t i = 0; i < length; i++) {
+    addr = (start + capture_tx_offset + i) & (CAPTURE_SIZE_C - 1);
+    vector_append_int24(capture_tx_buffer, capture_left[addr],  &index);
+    vector_append_int24(capture_tx_buffer, capture_right[addr], &index);
+  }
+
+  tx_mux_send(capture_tx_buffer, index);
+  capture_tx_offset += length;
+
+  if (capture_tx_offset == total) {
+    capture_seq++;
+    if (capture_mode == CAPTURE_SINGLE_E) {
+      capture_state = CAPTURE_IDLE_E;
+    } else {
+      capture_arm();
+    }
+  }
+}
+
+
+cmd_status_t cmd_capture_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t  index   = 4;
+  uint8_t  mode    = buffer[1];
+  uint8_t  trigger = buffer[2];
+  uint8_t  channel = buffer[3];
+  int32_t  level   = vector_get_int32(buffer,  &index);
+  uint32_t pre     = vector_get_uint16(buffer, &index);
+  uint32_t post    = vector_get_uint16(buffer, &index);
+  uint32_t timeout = vector_get_uint16(buffer, &index);
+
+  if (mode > CAPTURE_AUTO_E || trigger > CAPTURE_TRIG_FORCE_E ||
+      (channel != SAMPLE_CHANNEL_LEFT_C && channel != SAMPLE_CHANNEL_RIGHT_C) ||
+      post == 0 || pre + post > CAPTURE_SIZE_C ||
+      (mode == CAPTURE_AUTO_E && timeout == 0)) {
+    return CMD_FAILED_E;
+  }
+
+  // The irq_1 handler ignores the capture while it is idle
+  capture_state        = CAPTURE_IDLE_E;
+  capture_mode         = mode;
+  capture_trigger      = trigger;
+  capture_channel      = channel;
+  capture_level        = level;
+  capture_pre          = pre;
+  capture_post         = post;
+  capture_auto_timeout = timeout;
+
+  if (mode != CAPTURE_OFF_E) {
+    capture_arm();
+  }
+
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_capture_force(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+  capture_forced = 1;
+  return CMD_OK_E;
+}
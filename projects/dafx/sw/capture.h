@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Oscilloscope style triggered capture of the mixer output. The irq_1
+//   handler feeds every sample to capture_push(), which keeps the pre-trigger
+//   history and evaluates the trigger. Once the post-trigger part is complete,
+//   the main loop sends the window in CAPTURE_C chunks.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+
+#define CAPTURE_SIZE_C       2048 // Stereo samples, must be a power of two
+#define CAPTURE_CHUNK_SIZE_C 32
+
+_Static_assert((CAPTURE_SIZE_C & (CAPTURE_SIZE_C - 1)) == 0, "CAPTURE_SIZE_C must be a power of two");
+
+typedef enum {
+  CAPTURE_OFF_E,
+  CAPTURE_SINGLE_E,  // One capture, then off
+  CAPTURE_NORMAL_E,  // Re-armed after every capture
+  CAPTURE_AUTO_E     // As normal, but forced if there is no trigger within the timeout
+} capture_mode_t;
+
+typedef enum {
+  CAPTURE_TRIG_RISING_E,    // The channel crosses the level upwards
+  CAPTURE_TRIG_FALLING_E,   // The channel crosses the level downwards
+  CAPTURE_TRIG_AMPLITUDE_E, // The CIR DAC amplitude registers reach +/- level
+  CAPTURE_TRIG_FORCE_E      // Only 'F' triggers
+} capture_trigger_t;
+
+typedef enum {
+  CAPTURE_IDLE_E,
+  CAPTURE_ARMED_E,
+  CAPTURE_POST_E,
+  CAPTURE_DONE_E
+} capture_state_t;
+
+void         capture_init();
+void         capture_push(int32_t left, int32_t right);
+void         capture_poll();
+cmd_status_t cmd_capture_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_capture_force(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Opcode registry. New commands are added to CMD_LIST below; their length
+//   limits are checked at compile time and duplicated opcodes do not compile.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include "byte_vector.h"
+#include "dafx_axi.h"
+#include "qhost_defines.h"
+#include "log_ring.h"
+#include "preset.h"
+#include "init_ps.h"
+#include "sample_stream.h"
+#include "capture.h"
+#include "spectrum.h"
+#include "tx_mux.h"
+#include "amp.h"
+#include "link.h"
+#include "cmd_table.h"
+
+static cmd_status_t cmd_axi_write(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+static cmd_status_t cmd_axi_read(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+// X(opcode, handler, min_length, max_length, flags)
+#define CMD_LIST(X) \
+  X('W', cmd_axi_write,         9,  9, CMD_ISR_SAFE_C) \
+  X('R', cmd_axi_read,          5,  5, CMD_ISR_SAFE_C | CMD_NEEDS_RESPONSE_C) \
+  X('C', cmd_preset_capture,    2,  6, CMD_RT_C | CMD_NEEDS_RESPONSE_C) \
+  X('U', cmd_preset_upload,    34, 34, CMD_RT_C | CMD_NEEDS_RESPONSE_C) \
+  X('A', cmd_preset_apply,      2,  2, CMD_RT_C | CMD_ISR_SAFE_C) \
+  X('I', cmd_preset_info,       2,  2, CMD_RT_C | CMD_ISR_SAFE_C | CMD_NEEDS_RESPONSE_C) \
+  X('T', cmd_uart_rx_trigger,   3,  3, 0) \
+  X('S', cmd_sample_subscribe,  4,  4, CMD_RT_C) \
+  X('O', cmd_capture_config,   14, 14, CMD_RT_C) \
+  X('F', cmd_capture_force,     1,  1, CMD_RT_C | CMD_ISR_SAFE_C) \
+  X('X', cmd_spectrum_config,   6,  6, CMD_RT_C) \
+  X('M', cmd_tx_mux_stats,      2,  2, CMD_NEEDS_RESPONSE_C) \
+  X('Q', cmd_tx_mux_config,    10, 10, 0) \
+  X('H', cmd_link_hello,        1,  1, CMD_NEEDS_RESPONSE_C) \
+  X('B', cmd_link_switch,       8,  8, CMD_NEEDS_RESPONSE_C) \
+  X('E', cmd_link_echo,         1, FRAME_LENGTH_MAX_C - 1, CMD_NEEDS_RESPONSE_C)
+
+// Compile time checks of the lengths
+#define CMD_CHECK_LENGTH(op, fn, min, max, flags) \
+  _Static_assert((min) >= 1 && (min) <= (max) && (max) <= FRAME_LENGTH_MAX_C, "Bad length limits of " #fn);
+CMD_LIST(CMD_CHECK_LENGTH)
+
+// A duplicated opcode gives a duplicate case value
+#define CMD_CHECK_OPCODE(op, fn, min, max, flags) case (op): break;
+static inline void __attribute__((unused)) cmd_check_opcodes(uint8_t opcode) {
+  switch (opcode) {
+    CMD_LIST(CMD_CHECK_OPCODE)
+    default: break;
+  }
+}
+
+// Every command at its shortest, sizeof() is the largest minimum length
+#define CMD_MIN_LENGTH(op, fn, min, max, flags) uint8_t fn[min];
+typedef union {
+  CMD_LIST(CMD_MIN_LENGTH)
+} cmd_min_lengths_t;
+
+#define CMD_ENTRY(op, fn, min, max, flags) [(uint8_t)(op)] = {fn, min, max, flags},
+static const cmd_entry_t cmd_table[256] = {
+  CMD_LIST(CMD_ENTRY)
+};
+
+static uint8_t cmd_response[FRAME_LENGTH_MAX_C];
+
+
+// The smallest RX frame limit that still lets the host send every command
+int32_t cmd_frame_max_lower() {
+  return sizeof(cmd_min_lengths_t);
+}
+
+
+cmd_status_t cmd_dispatch(const uint8_t *buffer, int32_t length, uint32_t context) {
+
+  const cmd_entry_t *cmd;
+  cmd_status_t       status;
+  int32_t            response_length = 0;
+
+  if (length < 1) {
+    return CMD_BAD_LENGTH_E;
+  }
+
+  cmd = &cmd_table[buffer[0]];
+
+  if (cmd->handler == NULL) {
+    LOG_WARN(LOG_RX_UNKNOWN_E, buffer[0]);
+    return CMD_UNKNOWN_E;
+  }
+
+  if (length < cmd->min_length || length > cmd->max_length) {
+    LOG_WARN(LOG_RX_BAD_LENGTH_E, length, buffer[0]);
+    return CMD_BAD_LENGTH_E;
+  }
+
+  if ((context & CMD_CTX_ISR_C) && !(cmd->flags & CMD_ISR_SAFE_C)) {
+    return CMD_NOT_ISR_SAFE_E;
+  }
+
+  // The real-time state lives on CPU1 in the AMP build
+  if (AMP_LINK_CORE_C && (cmd->flags & CMD_RT_C)) {
+    return (amp_forward_cmd(buffer, length) == 0) ? CMD_OK_E : CMD_FAILED_E;
+  }
+
+  status = cmd->handler(buffer, length, cmd_response, &response_length);
+
+  if (status == CMD_OK_E && (cmd->flags & CMD_NEEDS_RESPONSE_C) && response_length > 0) {
+    tx_mux_send(cmd_response, response_length);
+  }
+
+  return status;
+}
+
+
+static cmd_status_t cmd_axi_write(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t  index = 1;
+  uint32_t addr;
+  uint32_t data;
+
+  addr = vector_get_uint32(buffer, &index);
+  data = vector_get_uint32(buffer, &index);
+  LOG_INFO(LOG_RX_WRITE_E, addr, data);
+  axi_write(FPGA_BASEADDR, addr, data);
+
+  return CMD_OK_E;
+}
+
+
+static cmd_status_t cmd_axi_read(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t  index = 1;
+  uint32_t addr;
+  uint32_t data;
+
+  addr = vector_get_uint32(buffer, &index);
+  data = axi_read(FPGA_BASEADDR, addr);
+  LOG_INFO(LOG_RX_READ_E, addr, data);
+
+  response[0] = REGISTER_READ_C;
+  index       = 1;
+  vector_append_uint32(response, addr, &index);
+  vector_append_uint32(response, data, &index);
+  *response_length = index;
+
+  return CMD_OK_E;
+}
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Opcode registry for the frames received from the host. Every opcode
+//   has a fixed slot in a 256 entry table, so dispatching a frame is a
+//   single lookup on its first byte.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMD_TABLE_H
+#define CMD_TABLE_H
+
+#include <stdint.h>
+
+// Entry flags
+#define CMD_NEEDS_RESPONSE_C 0x01 // The response buffer is sent to the host after the handler
+#define CMD_ISR_SAFE_C       0x02 // The handler may be called from interrupt context
+#define CMD_RT_C             0x04 // Executed by CPU1 in the AMP build, see amp.h
+
+// Dispatch context
+#define CMD_CTX_MAIN_C       0x00
+#define CMD_CTX_ISR_C        0x01
+
+typedef enum {
+  CMD_OK_E,
+  CMD_UNKNOWN_E,
+  CMD_BAD_LENGTH_E,
+  CMD_NOT_ISR_SAFE_E,
+  CMD_FAILED_E
+} cmd_status_t;
+
+// A handler receives the whole frame, i.e., buffer[0] is the opcode and the
+// arguments start at index 1. The length has already been checked against
+// the entry's limits. Responses are written to 'response' and their length
+// to 'response_length'.
+typedef cmd_status_t (*cmd_handler_t)(const uint8_t *buffer,
+                                      int32_t        length,
+                                      uint8_t       *response,
+                                      int32_t       *response_length);
+
+typedef struct {
+  cmd_handler_t handler;
+  uint16_t      min_length;
+  uint16_t      max_length;
+  uint8_t       flags;
+} cmd_entry_t;
+
+cmd_status_t cmd_dispatch(const uint8_t *buffer, int32_t length, uint32_t context);
+int32_t      cmd_frame_max_lower();
+
+#endif
@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   AXI access to the DAFX register file in the PL.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "xil_io.h"
+#include "dafx_axi.h"
+
+
+void axi_write(uint32_t baseaddr, uint32_t offset, int32_t value){
+  Xil_Out32(baseaddr + offset, value);
+}
+
+
+uint32_t axi_read(uint32_t baseaddr, uint32_t offset){
+  return Xil_In32(baseaddr + offset);
+}
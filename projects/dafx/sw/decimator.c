@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Integer factor FIR decimator, see decimator.h. The dot product has a NEON
+//   path when the compiler targets NEON (-mfpu=neon) and a scalar fallback.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "decimator.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define DECIMATOR_SAMPLE_MAX_C ((1 << 23) - 1)
+#define DECIMATOR_SAMPLE_MIN_C (-(1 << 23))
+#define DECIMATOR_CUTOFF_C     0.32f // -6 dB point, as a fraction of the output sample rate
+#define DECIMATOR_PI_C         3.14159265358979f
+
+
+// Windowed sinc (Blackman) low pass filter. The Blackman transition band is
+// about 5.5 / (factor * DECIMATOR_TAPS_PER_PHASE_C) of the input rate wide,
+// i.e., 0.34 of the output rate with 16 taps per phase, so with the cutoff at
+// 0.32 the stopband (below -60 dB) starts at the output Nyquist frequency and
+// the passband is flat to -1 dB up to half of it. The taps are rounded to Q15
+// and the center tap absorbs the rounding error so the DC gain is exactly one.
+int32_t decimator_design(decimator_coefs_t *coefs, int32_t factor) {
+
+  int32_t n;
+  int32_t sum = 0;
+  float   fc;
+  float   t;
+  float   w;
+  float   h;
+  float   gain = 0.0f;
+  float   taps[DECIMATOR_MAX_TAPS_C];
+
+  if (factor < 1 || factor > DECIMATOR_MAX_FACTOR_C) {
+    return -1;
+  }
+
+  coefs->factor = factor;
+
+  if (factor == 1) {
+    coefs->nr_of_taps = 1;
+    coefs->coefs[0]   = 1 << DECIMATOR_Q_BITS_C;
+    return 0;
+  }
+
+  n  = factor * DECIMATOR_TAPS_PER_PHASE_C;
+  fc = DECIMATOR_CUTOFF_C / factor;
+
+  for (int32_t k = 0; k < n; k++) {
+    t = k - (n - 1) / 2.0f;
+    w = 0.42f - 0.5f  * cosf(2.0f * DECIMATOR_PI_C * k / (n - 1))
+              + 0.08f * cosf(4.0f * DECIMATOR_PI_C * k / (n - 1));
+    h = (t == 0.0f) ? 2.0f * fc : sinf(2.0f * DECIMATOR_PI_C * fc * t) / (DECIMATOR_PI_C * t);
+    taps[k] = h * w;
+    gain   += taps[k];
+  }
+
+  for (int32_t k = 0; k < n; k++) {
+    coefs->coefs[k] = (int32_t)lrintf(taps[k] / gain * (1 << DECIMATOR_Q_BITS_C));
+    sum += coefs->coefs[k];
+  }
+  coefs->coefs[n / 2] += (1 << DECIMATOR_Q_BITS_C) - sum;
+  coefs->nr_of_taps    = n;
+
+  return 0;
+}
+
+
+void decimator_init(decimator_t *dec, const decimator_coefs_t *coefs) {
+
+  dec->coefs = coefs;
+  dec->phase = 0;
+  dec->pos   = 0;
+
+  for (int32_t i = 0; i < 2 * DECIMATOR_MAX_TAPS_C; i++) {
+    dec->history[i] = 0;
+  }
+}
+
+
+// x[0] is the newest sample
+static inline int32_t decimator_dot(const int32_t *h, const int32_t *x, int32_t n) {
+
+  int64_t acc = 0;
+  int32_t k   = 0;
+
+#if defined(__ARM_NEON)
+  int64x2_t acc_v = vdupq_n_s64(0);
+  int32x4_t h_v;
+  int32x4_t x_v;
+
+  for (; k + 4 <= n; k += 4) {
+    h_v   = vld1q_s32(&h[k]);
+    x_v   = vld1q_s32(&x[k]);
+    acc_v = vmlal_s32(acc_v, vget_low_s32(h_v),  vget_low_s32(x_v));
+    acc_v = vmlal_s32(acc_v, vget_high_s32(h_v), vget_high_s32(x_v));
+  }
+  acc = vgetq_lane_s64(acc_v, 0) + vgetq_lane_s64(acc_v, 1);
+#endif
+
+  for (; k < n; k++) {
+    acc += (int64_t)h[k] * x[k];
+  }
+
+  acc = (acc + (1 << (DECIMATOR_Q_BITS_C - 1))) >> DECIMATOR_Q_BITS_C;
+
+  if (acc > DECIMATOR_SAMPLE_MAX_C) {
+    return DECIMATOR_SAMPLE_MAX_C;
+  } else if (acc < DECIMATOR_SAMPLE_MIN_C) {
+    return DECIMATOR_SAMPLE_MIN_C;
+  }
+  return (int32_t)acc;
+}
+
+
+// The delay line is stored twice so the newest 'nr_of_taps' samples are
+// always contiguous, starting at 'pos'. Returns the number of outputs.
+int32_t decimator_process(decimator_t *dec, const int32_t *in, int32_t length, int32_t *out) {
+
+  const int32_t  n       = dec->coefs->nr_of_taps;
+  const int32_t  factor  = dec->coefs->factor;
+  const int32_t *h       = dec->coefs->coefs;
+  int32_t       *history = dec->history;
+  int32_t        pos     = dec->pos;
+  int32_t        phase   = dec->phase;
+  int32_t        nr_of_outputs = 0;
+
+  for (int32_t i = 0; i < length; i++) {
+
+    pos = (pos == 0) ? n - 1 : pos - 1;
+    history[pos]     = in[i];
+    history[pos + n] = in[i];
+
+    if (++phase == factor) {
+      phase = 0;
+      out[nr_of_outputs++] = decimator_dot(h, &history[pos], n);
+    }
+  }
+
+  dec->pos   = pos;
+  dec->phase = phase;
+
+  return nr_of_outputs;
+}
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Integer factor FIR decimator in fixed point. Only every factor:th output is
+//   computed (the polyphase form), with DECIMATOR_TAPS_PER_PHASE_C taps per
+//   phase, i.e., factor * DECIMATOR_TAPS_PER_PHASE_C multiply-accumulates per
+//   output sample. Samples are signed 24 bit, coefficients are Q15.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+
+#define DECIMATOR_MAX_FACTOR_C      32
+#define DECIMATOR_TAPS_PER_PHASE_C  16
+#define DECIMATOR_MAX_TAPS_C        (DECIMATOR_MAX_FACTOR_C * DECIMATOR_TAPS_PER_PHASE_C)
+#define DECIMATOR_Q_BITS_C          15
+
+typedef struct {
+  int32_t factor;
+  int32_t nr_of_taps;
+  int32_t coefs[DECIMATOR_MAX_TAPS_C];
+} decimator_coefs_t;
+
+typedef struct {
+  const decimator_coefs_t *coefs;
+  int32_t                  phase;
+  int32_t                  pos;
+  int32_t                  history[2 * DECIMATOR_MAX_TAPS_C];
+} decimator_t;
+
+int32_t decimator_design(decimator_coefs_t *coefs, int32_t factor);
+void    decimator_init(decimator_t *dec, const decimator_coefs_t *coefs);
+int32_t decimator_process(decimator_t *dec, const int32_t *in, int32_t length, int32_t *out);
+
+#endif
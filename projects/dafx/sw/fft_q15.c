@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Radix-2 decimation in time FFT in Q15, see fft_q15.h.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "fft_q15.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define FFT_PI_C 3.14159265358979f
+
+
+int32_t fft_q15_init(fft_q15_t *fft, int32_t size_log2) {
+
+  int32_t  size = 1 << size_log2;
+  uint32_t reversed;
+  float    angle;
+
+  if (size_log2 < 2 || size_log2 > FFT_MAX_SIZE_LOG2_C) {
+    return -1;
+  }
+
+  fft->size      = size;
+  fft->size_log2 = size_log2;
+
+  for (int32_t half = 1; half < size; half <<= 1) {
+    for (int32_t k = 0; k < half; k++) {
+      angle = -FFT_PI_C * k / half;
+      fft->twiddle_re[half - 1 + k] = (int16_t)lrintf(fminf(cosf(angle) * 32768.0f, 32767.0f));
+      fft->twiddle_im[half - 1 + k] = (int16_t)lrintf(fminf(sinf(angle) * 32768.0f, 32767.0f));
+    }
+  }
+
+  for (int32_t i = 0; i < size; i++) {
+    reversed = 0;
+    for (int32_t b = 0; b < size_log2; b++) {
+      reversed |= ((i >> b) & 1) << (size_log2 - 1 - b);
+    }
+    fft->bit_reverse[i] = reversed;
+  }
+
+  return 0;
+}
+
+
+static inline void fft_q15_butterfly(int16_t *re, int16_t *im, int32_t a, int32_t b, int16_t wr, int16_t wi) {
+
+  int32_t tr = ((int32_t)wr * re[b] - (int32_t)wi * im[b] + (1 << 14)) >> 15;
+  int32_t ti = ((int32_t)wr * im[b] + (int32_t)wi * re[b] + (1 << 14)) >> 15;
+  int32_t ar = re[a];
+  int32_t ai = im[a];
+
+  re[a] = (ar + tr) >> 1;
+  im[a] = (ai + ti) >> 1;
+  re[b] = (ar - tr) >> 1;
+  im[b] = (ai - ti) >> 1;
+}
+
+
+#if defined(__ARM_NEON)
+// Eight butterflies of one group, a[k] and b[k] = a[k + half]
+static inline void fft_q15_butterfly_x8(int16_t *ar_p, int16_t *ai_p, int16_t *br_p, int16_t *bi_p,
+                                        const int16_t *wr_p, const int16_t *wi_p) {
+
+  int16x8_t wr = vld1q_s16(wr_p);
+  int16x8_t wi = vld1q_s16(wi_p);
+  int16x8_t ar = vld1q_s16(ar_p);
+  int16x8_t ai = vld1q_s16(ai_p);
+  int16x8_t br = vld1q_s16(br_p);
+  int16x8_t bi = vld1q_s16(bi_p);
+  int16x8_t tr = vsubq_s16(vqrdmulhq_s16(wr, br), vqrdmulhq_s16(wi, bi));
+  int16x8_t ti = vaddq_s16(vqrdmulhq_s16(wr, bi), vqrdmulhq_s16(wi, br));
+
+  vst1q_s16(ar_p, vhaddq_s16(ar, tr));
+  vst1q_s16(ai_p, vhaddq_s16(ai, ti));
+  vst1q_s16(br_p, vhsubq_s16(ar, tr));
+  vst1q_s16(bi_p, vhsubq_s16(ai, ti));
+}
+#endif
+
+
+void fft_q15(const fft_q15_t *fft, int16_t *re, int16_t *im) {
+
+  const int32_t  size = fft->size;
+  const int16_t *wr;
+  const int16_t *wi;
+  int32_t        j;
+  int16_t        tmp;
+
+  for (int32_t i = 0; i < size; i++) {
+    j = fft->bit_reverse[i];
+    if (j > i) {
+      tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+      tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+    }
+  }
+
+  for (int32_t half = 1; half < size; half <<= 1) {
+
+    wr = &fft->twiddle_re[half - 1];
+    wi = &fft->twiddle_im[half - 1];
+
+    for (int32_t group = 0; group < size; group += 2 * half) {
+
+      int32_t k = 0;
+
+#if defined(__ARM_NEON)
+      for (; k + 8 <= half; k += 8) {
+        fft_q15_butterfly_x8(&re[group + k], &im[group + k], &re[group + half + k], &im[group + half + k], &wr[k], &wi[k]);
+      }
+#endif
+
+      for (; k < half; k++) {
+        fft_q15_butterfly(re, im, group + k, group + half + k, wr[k], wi[k]);
+      }
+    }
+  }
+}
@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   In-place radix-2 complex FFT in Q15 with the real and imaginary parts in
+//   separate arrays. Every stage halves its output, so the result is the DFT
+//   scaled by 1/size and never overflows. The butterflies have a NEON path
+//   when the compiler targets NEON (-mfpu=neon) and a scalar fallback.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include <stdint.h>
+
+#define FFT_MAX_SIZE_LOG2_C 10
+#define FFT_MAX_SIZE_C      (1 << FFT_MAX_SIZE_LOG2_C)
+
+typedef struct {
+  int32_t  size;
+  int32_t  size_log2;
+  // Twiddles of each stage stored contiguously, the stage with 'half'
+  // butterflies per group starts at index half - 1
+  int16_t  twiddle_re[FFT_MAX_SIZE_C];
+  int16_t  twiddle_im[FFT_MAX_SIZE_C];
+  uint16_t bit_reverse[FFT_MAX_SIZE_C];
+} fft_q15_t;
+
+int32_t fft_q15_init(fft_q15_t *fft, int32_t size_log2);
+void    fft_q15(const fft_q15_t *fft, int16_t *re, int16_t *im);
+
+#endif
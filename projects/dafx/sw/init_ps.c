@@ -20,6 +20,11 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "init_ps.h"
+#include "preset.h"
+#include "log_ring.h"
+#include "sample_stream.h"
+#include "capture.h"
+#include "amp.h"
 
 // IRQ
 XScuGic InterruptController;
@@ -27,20 +32,77 @@ static XScuGic_Config *gic_config;
 
 // Uart
 XUartPs Uart_PS;
-uint8_t irq_0_triggered;
 uint8_t irq_1_triggered;
 
+// UART RX ring, written by uart_rx_handler() and read by the main loop
+uint8_t           uart_rx_buffer[UART_RX_RING_SIZE_C];
+volatile uint32_t uart_rx_wr_addr;
+volatile uint32_t uart_rx_rd_addr;
+volatile uint32_t uart_rx_dropped;
 
-void irq_0_handler(void *InstancePtr) {
-  if (!irq_0_triggered) {
-    irq_0_triggered = 1;
-  }
-}
 
 void irq_1_handler(void *InstancePtr) {
+
+  int32_t left;
+  int32_t right;
+
+  preset_tick();
+  sample_stream_read(&left, &right);
+  sample_stream_push(left, right);
+  capture_push(left, right);
   irq_1_triggered = 1;
 }
 
+// Drains the RX FIFO into the RX ring on the FIFO trigger and the receive
+// timeout interrupts
+void uart_rx_handler(void *InstancePtr) {
+
+  XUartPs *uart    = (XUartPs *)InstancePtr;
+  uint32_t base    = uart->Config.BaseAddress;
+  uint32_t wr_addr = uart_rx_wr_addr;
+  uint32_t isr;
+  uint8_t  rx_data;
+
+  isr  = XUartPs_ReadReg(base, XUARTPS_IMR_OFFSET) & XUartPs_ReadReg(base, XUARTPS_ISR_OFFSET);
+  isr &= UART_RX_IRQ_MASK_C;
+
+  while (XUartPs_IsReceiveData(base)) {
+    rx_data = (uint8_t)XUartPs_ReadReg(base, XUARTPS_FIFO_OFFSET);
+    if (wr_addr - uart_rx_rd_addr < UART_RX_RING_SIZE_C) {
+      uart_rx_buffer[wr_addr & (UART_RX_RING_SIZE_C - 1)] = rx_data;
+      wr_addr++;
+    } else {
+      // Reported once per burst by parse_uart_rx()
+      uart_rx_dropped++;
+    }
+  }
+  uart_rx_wr_addr = wr_addr;
+
+  if (isr & XUARTPS_IXR_OVER) {
+    LOG_WARN(LOG_UART_RX_OVERRUN_E);
+  }
+
+  XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, isr);
+}
+
+void uart_rx_set_trigger(uint8_t threshold, uint8_t timeout) {
+  XUartPs_SetFifoThreshold(&Uart_PS, threshold);
+  XUartPs_SetRecvTimeout(&Uart_PS, timeout);
+}
+
+// 'T' threshold timeout
+cmd_status_t cmd_uart_rx_trigger(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  // The threshold is 6 bits and must leave room in the 64 byte FIFO, a zero
+  // timeout disables the timeout interrupt and strands the FIFO's tail
+  if (buffer[1] == 0 || buffer[1] > 63 || buffer[2] == 0) {
+    return CMD_FAILED_E;
+  }
+
+  uart_rx_set_trigger(buffer[1], buffer[2]);
+  return CMD_OK_E;
+}
+
 
 int32_t init_interrupt() {
 
@@ -48,27 +110,54 @@ int32_t init_interrupt() {
 
   gic_config = XScuGic_LookupConfig(XPAR_PS7_SCUGIC_0_DEVICE_ID);
   if (NULL == gic_config) {
-    xil_printf("%sFAIL [irq] XScuGic_LookupConfig\n\r", STR_C);
+    xil_printf("%cFAIL [irq] XScuGic_LookupConfig\n\r", STR_C);
     return XST_FAILURE;
   }
 
 
   status = XScuGic_CfgInitialize(&InterruptController, gic_config, gic_config->CpuBaseAddress);
   if (status != XST_SUCCESS) {
-    xil_printf("%sFAIL [irq] XScuGic_CfgInitialize\n\r", STR_C);
+    xil_printf("%cFAIL [irq] XScuGic_CfgInitialize\n\r", STR_C);
     return XST_FAILURE;
   }
 
-  status = XScuGic_Connect(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_0_INTR, (Xil_ExceptionHandler)irq_0_handler, (void *)NULL);
-  if (status != XST_SUCCESS) {
-    xil_printf("%sFAIL [irq] XScuGic_Connect\n\r", STR_C);
+#if AMP_LINK_CORE_C
+  // The distributor routes every interrupt to CPU0 after its initialization,
+  // CPU1 maps irq_1 to itself when it enables it
+  XScuGic_InterruptUnmapFromCpu(&InterruptController, XPAR_CPU_ID, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR);
+#else
+  init_irq_1();
+#endif
+  init_uart_irq();
+
+  Xil_ExceptionInit();
+  Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, (Xil_ExceptionHandler) XScuGic_InterruptHandler, &InterruptController);
+  Xil_ExceptionEnable();
+
+  return XST_SUCCESS;
+}
+
+// CPU1 of the AMP build only takes irq_1. Its BSP is built with USE_AMP=1, so
+// XScuGic_CfgInitialize() leaves the distributor set up by CPU0 alone.
+int32_t init_interrupt_rt() {
+
+  int32_t status;
+
+  gic_config = XScuGic_LookupConfig(XPAR_PS7_SCUGIC_0_DEVICE_ID);
+  if (NULL == gic_config) {
     return XST_FAILURE;
   }
 
-  XScuGic_SetPriorityTriggerType(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_0_INTR, 0x8, 0x3);
-  XScuGic_Enable(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_0_INTR);
+  status = XScuGic_CfgInitialize(&InterruptController, gic_config, gic_config->CpuBaseAddress);
+  if (status != XST_SUCCESS) {
+    return XST_FAILURE;
+  }
 
-  init_irq_1();
+  status = init_irq_1();
+  if (status != XST_SUCCESS) {
+    return XST_FAILURE;
+  }
+  XScuGic_InterruptMaptoCpu(&InterruptController, XPAR_CPU_ID, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR);
 
   Xil_ExceptionInit();
   Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT, (Xil_ExceptionHandler) XScuGic_InterruptHandler, &InterruptController);
@@ -83,13 +172,35 @@ int32_t init_irq_1() {
 
   status = XScuGic_Connect(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR, (Xil_ExceptionHandler)irq_1_handler, (void *)NULL);
   if (status != XST_SUCCESS) {
-    xil_printf("%sFAIL [irq_1] XScuGic_Connect\n\r", STR_C);
+    xil_printf("%cFAIL [irq_1] XScuGic_Connect\n\r", STR_C);
     return XST_FAILURE;
   }
   XScuGic_SetPriorityTriggerType(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR, 0x8, 0x3);
   XScuGic_Enable(&InterruptController, XPAR_FABRIC_BD_PROJECT_TOP_0_IRQ_1_INTR);
 
-  xil_printf("%sINFO [irq_1] Init complete\n\r", STR_C);
+  xil_printf("%cINFO [irq_1] Init complete\n\r", STR_C);
+  return XST_SUCCESS;
+}
+
+int32_t init_uart_irq() {
+
+  int32_t status;
+
+  uart_rx_set_trigger(UART_RX_FIFO_THRESHOLD_C, UART_RX_TIMEOUT_C);
+
+  status = XScuGic_Connect(&InterruptController, XPAR_XUARTPS_0_INTR, (Xil_ExceptionHandler)uart_rx_handler, (void *)&Uart_PS);
+  if (status != XST_SUCCESS) {
+    xil_printf("%cFAIL [uart] XScuGic_Connect\n\r", STR_C);
+    return XST_FAILURE;
+  }
+
+  // The PS UART interrupt is level sensitive
+  XScuGic_SetPriorityTriggerType(&InterruptController, XPAR_XUARTPS_0_INTR, UART_RX_PRIORITY_C, 0x1);
+  XScuGic_Enable(&InterruptController, XPAR_XUARTPS_0_INTR);
+
+  XUartPs_SetInterruptMask(&Uart_PS, UART_RX_IRQ_MASK_C);
+
+  xil_printf("%cINFO [uart] RX interrupts enabled\n\r", STR_C);
   return XST_SUCCESS;
 }
 
@@ -100,23 +211,33 @@ int32_t init_uart(uint16_t DeviceId){
 
   config = XUartPs_LookupConfig(DeviceId);
   if (NULL == config) {
-    xil_printf("%sFAIL [irq] XUartPs_LookupConfig\n\r", STR_C);
+    xil_printf("%cFAIL [irq] XUartPs_LookupConfig\n\r", STR_C);
     return XST_FAILURE;
   }
 
   status = XUartPs_CfgInitialize(&Uart_PS, config, config->BaseAddress);
   if (status != XST_SUCCESS) {
-    xil_printf("%sFAIL [irq] XUartPs_CfgInitialize\n\r", STR_C);
+    xil_printf("%cFAIL [irq] XUartPs_CfgInitialize\n\r", STR_C);
     return XST_FAILURE;
   }
 
   status = XUartPs_SelfTest(&Uart_PS);
   if (status != XST_SUCCESS) {
-    xil_printf("%sFAIL [irq] XUartPs_SelfTest\n\r", STR_C);
+    xil_printf("%cFAIL [irq] XUartPs_SelfTest\n\r", STR_C);
     return XST_FAILURE;
   }
 
   XUartPs_SetOperMode(&Uart_PS, XUARTPS_OPER_MODE_NORMAL);
 
+  status = XUartPs_SetBaudRate(&Uart_PS, UART_BAUD_RATE_C);
+  if (status != XST_SUCCESS) {
+    xil_printf("%cFAIL [irq] XUartPs_SetBaudRate\n\r", STR_C);
+    return XST_FAILURE;
+  }
+
+  uart_rx_wr_addr = 0;
+  uart_rx_rd_addr = 0;
+  uart_rx_dropped = 0;
+
   return XST_SUCCESS;
 }
@@ -25,14 +25,31 @@
 #include "xscugic.h"
 #include "xuartps.h"
 #include "qhost_defines.h"
+#include "cmd_table.h"
 
 #ifndef INIT_PS_H
 #define INIT_PS_H
 
-int32_t init_uart(uint16_t DeviceId);
-int32_t init_interrupt();
-int32_t init_irq_1();
-void    irq_0_handler(void *InstancePtr);
-void    irq_1_handler(void *InstancePtr);
+// UART
+#define UART_BAUD_RATE_C          115200 // Rate after reset, see link.h for switching
+
+// UART RX
+#define UART_RX_RING_SIZE_C       1024 // Must be a power of two
+#define UART_RX_FIFO_THRESHOLD_C  32   // Bytes in the 64 byte RX FIFO before the trigger interrupt
+#define UART_RX_TIMEOUT_C         8    // Idle time before the timeout interrupt, in units of 4 bit periods
+#define UART_RX_PRIORITY_C        0x10
+#define UART_RX_IRQ_MASK_C        (XUARTPS_IXR_RXOVR | XUARTPS_IXR_RXFULL | XUARTPS_IXR_TOUT | XUARTPS_IXR_OVER)
+
+_Static_assert((UART_RX_RING_SIZE_C & (UART_RX_RING_SIZE_C - 1)) == 0, "UART_RX_RING_SIZE_C must be a power of two");
+
+int32_t      init_uart(uint16_t DeviceId);
+int32_t      init_interrupt();
+int32_t      init_interrupt_rt();
+int32_t      init_irq_1();
+int32_t      init_uart_irq();
+void         irq_1_handler(void *InstancePtr);
+void         uart_rx_handler(void *InstancePtr);
+void         uart_rx_set_trigger(uint8_t threshold, uint8_t timeout);
+cmd_status_t cmd_uart_rx_trigger(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
 
 #endif
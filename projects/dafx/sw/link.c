@@ -0,0 +1,242 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   HELLO, link switching and echo, see link.h.
+//
+//   HELLO reply:  [HELLO_C][version][features16][frame max16][current frame
+//                  max16][crc][baud32][nr of rates][rate32]...
+//   Switch:       ['B'][baud32][crc][frame max16]
+//   Switch reply: [LINK_C][status][baud32][crc][frame max16]
+//   Echo:         ['E'][payload]...
+//   Echo reply:   [ECHO_C][payload length][payload]...
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "xuartps.h"
+#include "xtime_l.h"
+#include "byte_vector.h"
+#include "qhost_defines.h"
+#include "init_ps.h"
+#include "log_ring.h"
+#include "tx_mux.h"
+#include "amp.h"
+#include "rx_parser.h"
+#include "link.h"
+
+extern XUartPs           Uart_PS;
+extern uint8_t           uart_rx_buffer[];
+extern volatile uint32_t uart_rx_wr_addr;
+extern volatile uint32_t uart_rx_rd_addr;
+
+#define LINK_BAUD_RATE(rate) rate,
+static const uint32_t link_baud_rates[] = {
+  LINK_BAUD_RATES(LINK_BAUD_RATE)
+};
+#undef LINK_BAUD_RATE
+
+#define LINK_NR_OF_BAUD_RATES_C (sizeof(link_baud_rates) / sizeof(link_baud_rates[0]))
+
+static const uint16_t link_features = LINK_FEATURE_CRC16_C     |
+                                      LINK_FEATURE_LENGTH_16_C |
+                                      LINK_FEATURE_INT24_C     |
+                                      LINK_FEATURE_LOG_C       |
+                                      LINK_FEATURE_SPECTRUM_C  |
+                                      LINK_FEATURE_TX_MUX_C    |
+                                      (AMP_LINK_CORE_C ? LINK_FEATURE_AMP_C : 0);
+
+static link_state_t    link_state;
+static link_settings_t link_current;
+static link_settings_t link_previous;
+static link_settings_t link_requested;
+static XTime           link_switch_time;
+
+
+static int32_t link_apply(const link_settings_t *settings) {
+
+  int32_t status;
+
+  status = XUartPs_SetBaudRate(&Uart_PS, settings->baud_rate);
+  if (status != XST_SUCCESS) {
+    return status;
+  }
+
+  rx_crc_enabled = settings->crc_enabled;
+  rx_frame_max   = settings->frame_max;
+
+  // Whatever arrived during the switch was sent at the other rate
+  uart_rx_rd_addr = uart_rx_wr_addr;
+  parse_uart_reset();
+
+  link_current = *settings;
+  return XST_SUCCESS;
+}
+
+
+void link_init() {
+
+  link_state               = LINK_IDLE_E;
+  link_current.baud_rate   = UART_BAUD_RATE_C;
+  link_current.crc_enabled = LINK_CRC_DEFAULT_C;
+  link_current.frame_max   = FRAME_LENGTH_MAX_C;
+
+  rx_crc_enabled = link_current.crc_enabled;
+  rx_frame_max   = link_current.frame_max;
+}
+
+
+void link_poll() {
+
+  XTime now;
+
+  switch (link_state) {
+
+    // The ACK must leave at the old rate. XUartPs_SetBaudRate() resets the TX
+    // path, so the settings change once the last byte has been shifted out.
+    // Only the reply stream is sent meanwhile and the main loop keeps running.
+    case LINK_REQUESTED_E:
+
+      tx_mux_reply_only(1);
+      if (!tx_mux_idle()) {
+        break;
+      }
+      tx_mux_reply_only(0);
+
+      link_previous = link_current;
+      if (link_apply(&link_requested) != XST_SUCCESS) {
+        link_apply(&link_previous);
+        link_state = LINK_IDLE_E;
+        break;
+      }
+      XTime_GetTime(&link_switch_time);
+      link_state = LINK_PENDING_E;
+      break;
+
+
+    case LINK_PENDING_E:
+
+      XTime_GetTime(&now);
+      if (now - link_switch_time > (XTime)COUNTS_PER_SECOND / 1000 * LINK_SWITCH_TIMEOUT_MS_C) {
+        tx_mux_reply_only(1);
+        link_state = LINK_FALLBACK_E;
+      }
+      break;
+
+
+    // Same wait as for the switch before the old settings are restored
+    case LINK_FALLBACK_E:
+
+      if (!tx_mux_idle()) {
+        break;
+      }
+      tx_mux_reply_only(0);
+
+      link_apply(&link_previous);
+      link_state = LINK_IDLE_E;
+      LOG_WARN(LOG_LINK_FALLBACK_E, link_requested.baud_rate, link_previous.baud_rate);
+      break;
+
+
+    default:
+      break;
+  }
+}
+
+
+// A HELLO received while a switch is pending confirms the new settings
+cmd_status_t cmd_link_hello(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t index = 0;
+
+  if (link_state == LINK_PENDING_E) {
+    link_state = LINK_IDLE_E;
+    LOG_INFO(LOG_LINK_SWITCHED_E, link_current.baud_rate, link_current.crc_enabled, link_current.frame_max);
+  }
+
+  response[index++] = HELLO_C;
+  response[index++] = PROTOCOL_VERSION_C;
+  vector_append_uint16(response, link_features,            &index);
+  vector_append_uint16(response, FRAME_LENGTH_MAX_C,       &index);
+  vector_append_uint16(response, link_current.frame_max,   &index);
+  response[index++] = link_current.crc_enabled;
+  vector_append_uint32(response, link_current.baud_rate,   &index);
+  response[index++] = LINK_NR_OF_BAUD_RATES_C;
+  for (uint32_t i = 0; i < LINK_NR_OF_BAUD_RATES_C; i++) {
+    vector_append_uint32(response, link_baud_rates[i], &index);
+  }
+
+  *response_length = index;
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_link_switch(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t         index  = 1;
+  uint8_t         status = LINK_BAD_BAUD_C;
+  link_settings_t settings;
+
+  settings.baud_rate   = vector_get_uint32(buffer, &index);
+  settings.crc_enabled = buffer[index++] ? 1 : 0;
+  settings.frame_max   = vector_get_uint16(buffer, &index);
+
+  for (uint32_t i = 0; i < LINK_NR_OF_BAUD_RATES_C; i++) {
+    if (link_baud_rates[i] == settings.baud_rate) {
+      status = LINK_ACK_C;
+    }
+  }
+
+  // Below the longest fixed length command the host would lock itself out
+  if (settings.frame_max < cmd_frame_max_lower() || settings.frame_max > FRAME_LENGTH_MAX_C) {
+    status = LINK_BAD_FRAME_LENGTH_C;
+  }
+
+  if (link_state != LINK_IDLE_E) {
+    status = LINK_BUSY_C;
+  }
+
+  if (status == LINK_ACK_C) {
+    link_requested = settings;
+    link_state     = LINK_REQUESTED_E;
+  }
+
+  index = 0;
+  response[index++] = LINK_C;
+  response[index++] = status;
+  vector_append_uint32(response, settings.baud_rate, &index);
+  response[index++] = settings.crc_enabled;
+  vector_append_uint16(response, settings.frame_max, &index);
+
+  *response_length = index;
+  return CMD_OK_E;
+}
+
+
+// Round trip of any frame length, used by host/link_bench.c
+cmd_status_t cmd_link_echo(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t index = 0;
+
+  response[index++] = ECHO_C;
+  response[index++] = length - 1;
+  for (int32_t i = 1; i < length; i++) {
+    response[index++] = buffer[i];
+  }
+
+  *response_length = index;
+  return CMD_OK_E;
+}
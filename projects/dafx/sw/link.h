@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Link capabilities and runtime switching of the baud rate, the RX CRC
+//   mode and the maximum RX frame length.
+//
+//   HELLO ('H') replies with the protocol version, the features, the frame
+//   lengths, the current settings and the supported baud rates.
+//
+//   A switch ('B') is acknowledged at the old settings. The firmware then
+//   waits, without blocking, until the ACK has left the UART's shift
+//   register, changes the settings and expects a HELLO with the new settings
+//   within LINK_SWITCH_TIMEOUT_MS_C. Without it the old settings are
+//   restored, so a host or cable that cannot keep up never loses the board.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+
+#define LINK_CRC_DEFAULT_C        1
+#define LINK_SWITCH_TIMEOUT_MS_C  1000
+
+// Rates offered to the host. All of them are within about 1 % from the
+// 100 MHz reference clock of the PS UART and common rates of USB serial
+// bridges.
+#define LINK_BAUD_RATES(X) \
+  X(115200)  \
+  X(230400)  \
+  X(460800)  \
+  X(921600)  \
+  X(1000000) \
+  X(2000000) \
+  X(3000000)
+
+// Features in the HELLO reply
+#define LINK_FEATURE_CRC16_C      0x0001 // Optional CRC16 after the RX payload
+#define LINK_FEATURE_LENGTH_16_C  0x0002 // LENGTH_16_BITS_C frames
+#define LINK_FEATURE_INT24_C      0x0004 // Big endian int24 samples in SAMPLE_BLOCK_C and CAPTURE_C
+#define LINK_FEATURE_LOG_C        0x0008 // Binary LOG_C records
+#define LINK_FEATURE_SPECTRUM_C   0x0010 // SPECTRUM_C frames
+#define LINK_FEATURE_TX_MUX_C     0x0020 // TX stream budgets, TX_STATS_C
+#define LINK_FEATURE_AMP_C        0x0040 // Real-time side on CPU1
+
+// Status of the LINK_C reply to a switch
+#define LINK_ACK_C                0x00
+#define LINK_BAD_BAUD_C           0x01
+#define LINK_BAD_FRAME_LENGTH_C   0x02
+#define LINK_BUSY_C               0x03
+
+typedef enum {
+  LINK_IDLE_E,
+  LINK_REQUESTED_E, // Switch acknowledged, ACK not yet sent
+  LINK_PENDING_E,   // New settings applied, waiting for a HELLO
+  LINK_FALLBACK_E   // No HELLO, waiting for TX before restoring the old settings
+} link_state_t;
+
+typedef struct {
+  uint32_t baud_rate;
+  int32_t  crc_enabled;
+  int32_t  frame_max;
+} link_settings_t;
+
+void         link_init();
+void         link_poll();
+cmd_status_t cmd_link_hello(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_link_echo(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_link_switch(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif
@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Message ids of the binary log. The host decoder (host/log_decode.py)
+//   reads this file to turn the ids back into strings, so only append to the
+//   list and keep one X() entry per line.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+// X(id, format)
+#define LOG_MESSAGES(X) \
+  X(LOG_RING_DROPPED_E,      "[log] %u records dropped") \
+  X(LOG_RX_FRAME_E,          "[rx] Frame of length %d") \
+  X(LOG_RX_BAD_CRC_E,        "[rx] Bad CRC, %x != %x") \
+  X(LOG_RX_UNKNOWN_E,        "[rx] Unknown opcode %x") \
+  X(LOG_RX_BAD_LENGTH_E,     "[rx] Bad length %d of opcode %x") \
+  X(LOG_RX_WRITE_E,          "[rx] waddr(%u) wdata(%u)") \
+  X(LOG_RX_READ_E,           "[rx] raddr(%u) rdata(%d)") \
+  X(LOG_UART_RX_OVERRUN_E,   "[uart] RX FIFO overrun") \
+  X(LOG_UART_RX_RING_FULL_E, "[uart] RX ring full, %u bytes dropped") \
+  X(LOG_SAMPLE_OVERRUN_E,    "[sample] %u samples dropped") \
+  X(LOG_AMP_CMD_DROPPED_E,   "[amp] Command %x dropped, CPU1 queue full") \
+  X(LOG_RX_TOO_LONG_E,       "[rx] Frame length %d above the maximum %d") \
+  X(LOG_LINK_SWITCHED_E,     "[link] Running at %u baud, CRC %d, frames up to %d") \
+  X(LOG_LINK_FALLBACK_E,     "[link] No HELLO at %u baud, back to %u baud") \
+  X(LOG_PRESET_APPLY_DROPPED_E, "[preset] Apply of slot %d dropped, the slot was rewritten") \
+  X(LOG_AMP_RT_IRQ_FAILED_E, "[amp] CPU1 interrupt setup failed, status %d")
+
+#define LOG_MESSAGE_ID(id, format) id,
+typedef enum {
+  LOG_MESSAGES(LOG_MESSAGE_ID)
+  LOG_NR_OF_MESSAGES_E
+} log_message_t;
+#undef LOG_MESSAGE_ID
+
+#endif
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Deferred binary logging, see log_ring.h.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "byte_vector.h"
+#include "qhost_defines.h"
+#include "tx_mux.h"
+#include "log_ring.h"
+
+log_record_t      log_ring[LOG_RING_SIZE_C];
+volatile uint32_t log_wr_addr;
+volatile uint32_t log_rd_addr;
+volatile uint32_t log_dropped;
+static   uint32_t log_dropped_reported;
+static   uint8_t  log_tx_buffer[LOG_FRAME_MAX_C];
+
+
+void log_init() {
+  log_wr_addr          = 0;
+  log_rd_addr          = 0;
+  log_dropped          = 0;
+  log_dropped_reported = 0;
+}
+
+
+static int32_t log_encode(uint8_t *buffer, const log_record_t *record) {
+
+  int32_t index = 1;
+
+  buffer[0] = LOG_C;
+  vector_append_uint32(buffer, record->timestamp, &index);
+  vector_append_uint16(buffer, record->id,        &index);
+  buffer[index++] = (record->level << 4) | record->nr_of_args;
+  for (int32_t i = 0; i < record->nr_of_args; i++) {
+    vector_append_int32(buffer, record->args[i], &index);
+  }
+  return index;
+}
+
+
+// Queues at most 'max_records' records while the log stream of the TX
+// multiplexer has room for them
+void log_drain(int32_t max_records) {
+
+  log_record_t record;
+  uint32_t     dropped;
+  int32_t      length;
+
+  for (int32_t i = 0; i < max_records; i++) {
+
+    if (tx_mux_free(LOG_C) < LOG_FRAME_MAX_C) {
+      return;
+    }
+
+    dropped = log_dropped;
+
+    if (log_rd_addr != log_wr_addr) {
+      record = log_ring[log_rd_addr & (LOG_RING_SIZE_C - 1)];
+      log_rd_addr++;
+    }
+    else if (dropped != log_dropped_reported) {
+      record.timestamp     = Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_COUNTER_LOWER_OFFSET);
+      record.id            = LOG_RING_DROPPED_E;
+      record.level         = LOG_LEVEL_WARN_C;
+      record.nr_of_args    = 1;
+      record.args[0]       = dropped - log_dropped_reported;
+      log_dropped_reported = dropped;
+    }
+    else {
+      return;
+    }
+
+    length = log_encode(log_tx_buffer, &record);
+    tx_mux_send(log_tx_buffer, length);
+  }
+}
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Deferred binary logging. LOG_*() stores a timestamp, a message id and up
+//   to LOG_MAX_ARGS_C integer arguments in a RAM ring; nothing is formatted on
+//   the target. log_drain() is called from the main loop and queues the
+//   records as LOG_C frames on the log stream of the TX multiplexer while the
+//   stream has room; its budget limits the log's share of the link.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+#include "xil_io.h"
+#include "xtime_l.h"
+#include "log_messages.h"
+
+#define LOG_LEVEL_DEBUG_C 0
+#define LOG_LEVEL_INFO_C  1
+#define LOG_LEVEL_WARN_C  2
+#define LOG_LEVEL_ERROR_C 3
+#define LOG_LEVEL_OFF_C   4
+
+// Records below this level are removed at compile time
+#ifndef LOG_LEVEL_C
+#define LOG_LEVEL_C LOG_LEVEL_INFO_C
+#endif
+
+#define LOG_RING_SIZE_C   128 // Must be a power of two
+#define LOG_MAX_ARGS_C    4
+#define LOG_DRAIN_RECORDS_C 4 // Records queued per main loop iteration
+
+// Frame: type, timestamp (4), id (2), level << 4 | nr of args, args (4 each)
+#define LOG_FRAME_MAX_C   (8 + 4 * LOG_MAX_ARGS_C)
+
+_Static_assert((LOG_RING_SIZE_C & (LOG_RING_SIZE_C - 1)) == 0, "LOG_RING_SIZE_C must be a power of two");
+
+typedef struct {
+  uint32_t timestamp;
+  uint16_t id;
+  uint8_t  level;
+  uint8_t  nr_of_args;
+  int32_t  args[LOG_MAX_ARGS_C];
+} log_record_t;
+
+extern log_record_t      log_ring[LOG_RING_SIZE_C];
+extern volatile uint32_t log_wr_addr;
+extern volatile uint32_t log_rd_addr;
+extern volatile uint32_t log_dropped;
+
+void log_init();
+void log_drain(int32_t max_records);
+
+#define LOG_NR_OF_ARGS(...)                     LOG_NR_OF_ARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_NR_OF_ARGS_(_0, _1, _2, _3, _4, n, ...) n
+
+#define LOG_AT(level, id, ...) do {                                              \
+    if ((level) >= LOG_LEVEL_C) {                                                \
+      const int32_t log_args_[LOG_MAX_ARGS_C + 1] = {0, ##__VA_ARGS__};          \
+      log_write((level), (id), LOG_NR_OF_ARGS(__VA_ARGS__), &log_args_[1]);      \
+    }                                                                            \
+  } while (0)
+
+#define LOG_DEBUG(id, ...) LOG_AT(LOG_LEVEL_DEBUG_C, id, ##__VA_ARGS__)
+#define LOG_INFO(id, ...)  LOG_AT(LOG_LEVEL_INFO_C,  id, ##__VA_ARGS__)
+#define LOG_WARN(id, ...)  LOG_AT(LOG_LEVEL_WARN_C,  id, ##__VA_ARGS__)
+#define LOG_ERROR(id, ...) LOG_AT(LOG_LEVEL_ERROR_C, id, ##__VA_ARGS__)
+
+
+// Masks IRQs on this core while a slot is claimed and filled, so the
+// main loop and the ISRs can log into the same ring
+static inline uint32_t log_irq_save() {
+#if defined(__arm__)
+  uint32_t cpsr;
+  __asm__ volatile ("mrs %0, cpsr\n\tcpsid i" : "=r" (cpsr) :: "memory");
+  return cpsr;
+#else
+  return 0;
+#endif
+}
+
+static inline void log_irq_restore(uint32_t cpsr) {
+#if defined(__arm__)
+  __asm__ volatile ("msr cpsr_c, %0" :: "r" (cpsr) : "memory");
+#else
+  (void)cpsr;
+#endif
+}
+
+static inline void log_write(uint8_t level, uint16_t id, uint8_t nr_of_args, const int32_t *args) {
+
+  uint32_t      cpsr = log_irq_save();
+  uint32_t      wr   = log_wr_addr;
+  log_record_t *record;
+
+  if (wr - log_rd_addr >= LOG_RING_SIZE_C) {
+    log_dropped++;
+    log_irq_restore(cpsr);
+    return;
+  }
+
+  record             = &log_ring[wr & (LOG_RING_SIZE_C - 1)];
+  record->timestamp  = Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_COUNTER_LOWER_OFFSET);
+  record->id         = id;
+  record->level      = level;
+  record->nr_of_args = nr_of_args;
+  for (int32_t i = 0; i < nr_of_args; i++) {
+    record->args[i] = args[i];
+  }
+  log_wr_addr = wr + 1;
+
+  log_irq_restore(cpsr);
+}
+
+#endif
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   main() of CPU1 in the AMP build, see amp.h. CPU1 takes irq_1 and runs
+//   the commands CPU0 forwards to it; everything it sends to the host goes
+//   through the shared queue to CPU0.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include "xparameters.h"
+#include "init_ps.h"
+#include "cmd_table.h"
+#include "log_ring.h"
+#include "preset.h"
+#include "sample_stream.h"
+#include "capture.h"
+#include "spectrum.h"
+#include "tx_mux.h"
+#include "amp.h"
+
+#if AMP_RT_CORE_C
+
+extern uint8_t irq_1_triggered;
+
+int main() {
+
+  int32_t status;
+
+  amp_wait_link();
+
+  // Only the type to stream map is used on CPU1, to pick the shared queue
+  tx_mux_init();
+  log_init();
+  preset_init();
+  sample_stream_init();
+  capture_init();
+  spectrum_init();
+
+  // CPU1 has no console, a failure is logged through CPU0 and CPU0 times out
+  // waiting for the ready flag, so no commands are forwarded to this core
+  status = init_interrupt_rt();
+  if (status == XST_SUCCESS) {
+    amp_signal_ready();
+  } else {
+    LOG_ERROR(LOG_AMP_RT_IRQ_FAILED_E, status);
+  }
+
+  while (1) {
+
+    // Commands forwarded by CPU0
+    amp_poll_rt();
+
+    // IRQ1: Decimate and send the mixer's output sampled by the ISR
+    if (irq_1_triggered) {
+      sample_stream_poll();
+      irq_1_triggered = 0;
+    }
+
+    // Send the next chunk of a completed capture
+    capture_poll();
+
+    // Queue pending log records
+    log_drain(LOG_DRAIN_RECORDS_C);
+  }
+
+  return 0;
+}
+
+#endif
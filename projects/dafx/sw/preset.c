@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Register preset slots, see preset.h.
+//
+//   'C' slot [tag]       Captures the current RW registers into a slot, the
+//                        tag is all four bytes or left out
+//   'U' slot tag values  Uploads a slot, one uint32 per RW register
+//   'A' slot             Applies a slot at the next irq_1 tick
+//   'I' slot             Replies with the slot's valid flag, tag and CRC
+//
+//   The CRC is crc_16() over the values as big endian uint32, so the host can
+//   compare it to its own copy and skip uploading presets the board has.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "byte_vector.h"
+#include "crc_16.h"
+#include "dafx_address.h"
+#include "dafx_axi.h"
+#include "log_ring.h"
+#include "qhost_defines.h"
+#include "preset.h"
+
+static const uint32_t preset_addr[PRESET_NR_OF_REGS_C] = {
+  DAFX_MIXER_OUTPUT_GAIN_ADDR,
+  DAFX_MIXER_CHANNEL_GAIN_0_ADDR,
+  DAFX_MIXER_CHANNEL_GAIN_1_ADDR,
+  DAFX_MIXER_CHANNEL_GAIN_2_ADDR,
+  DAFX_OSC0_WAVEFORM_SELECT_ADDR,
+  DAFX_OSC0_FREQUENCY_ADDR,
+  DAFX_OSC0_DUTY_CYCLE_ADDR
+};
+
+static   preset_slot_t preset_slots[PRESET_SLOTS_C];
+volatile int32_t       preset_pending;
+
+
+void preset_init() {
+  for (int32_t i = 0; i < PRESET_SLOTS_C; i++) {
+    preset_slots[i].valid = 0;
+  }
+  preset_pending = PRESET_NONE_C;
+}
+
+
+// Called from the irq_1 handler
+void preset_tick() {
+
+  int32_t        slot = preset_pending;
+  preset_slot_t *preset;
+
+  if (slot == PRESET_NONE_C) {
+    return;
+  }
+
+  preset_pending = PRESET_NONE_C;
+  preset         = &preset_slots[slot];
+
+  // An upload or capture of the slot between the 'A' and this tick clears
+  // the valid flag, the apply is dropped rather than writing half a preset
+  if (!__atomic_load_n(&preset->valid, __ATOMIC_ACQUIRE)) {
+    LOG_WARN(LOG_PRESET_APPLY_DROPPED_E, slot);
+    return;
+  }
+
+  for (int32_t i = 0; i < PRESET_NR_OF_REGS_C; i++) {
+    axi_write(FPGA_BASEADDR, preset_addr[i], preset->values[i]);
+  }
+}
+
+
+// The irq_1 handler reads the values only after it has seen the valid flag,
+// so the flag is cleared before and set after the values with a barrier
+static void preset_invalidate(preset_slot_t *preset) {
+  __atomic_store_n(&preset->valid, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+static void preset_validate(preset_slot_t *preset) {
+  __atomic_store_n(&preset->valid, 1, __ATOMIC_RELEASE);
+}
+
+
+static uint16_t preset_crc(const preset_slot_t *preset) {
+
+  uint8_t bytes[4 * PRESET_NR_OF_REGS_C];
+  int32_t index = 0;
+
+  for (int32_t i = 0; i < PRESET_NR_OF_REGS_C; i++) {
+    vector_append_uint32(bytes, preset->values[i], &index);
+  }
+  return crc_16(bytes, index);
+}
+
+
+static void preset_append_info(uint8_t *response, int32_t *response_length, int32_t slot) {
+
+  int32_t index = 0;
+
+  response[index++] = PRESET_INFO_C;
+  response[index++] = slot;
+  response[index++] = preset_slots[slot].valid;
+  vector_append_uint32(response, preset_slots[slot].tag, &index);
+  vector_append_uint16(response, preset_slots[slot].crc, &index);
+  *response_length = index;
+}
+
+
+cmd_status_t cmd_preset_capture(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t        index = 2;
+  int32_t        slot  = buffer[1];
+  preset_slot_t *preset;
+
+  if (slot >= PRESET_SLOTS_C || (length != 2 && length != 6)) {
+    return CMD_FAILED_E;
+  }
+
+  preset        = &preset_slots[slot];
+  preset_invalidate(preset);
+  for (int32_t i = 0; i < PRESET_NR_OF_REGS_C; i++) {
+    preset->values[i] = axi_read(FPGA_BASEADDR, preset_addr[i]);
+  }
+  preset->tag   = (length == 6) ? vector_get_uint32(buffer, &index) : 0;
+  preset->crc   = preset_crc(preset);
+  preset_validate(preset);
+
+  preset_append_info(response, response_length, slot);
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_preset_upload(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t        index = 2;
+  int32_t        slot  = buffer[1];
+  preset_slot_t *preset;
+
+  if (slot >= PRESET_SLOTS_C) {
+    return CMD_FAILED_E;
+  }
+
+  // The slot is invalid while it is written so a pending apply skips it
+  preset        = &preset_slots[slot];
+  preset_invalidate(preset);
+  preset->tag   = vector_get_uint32(buffer, &index);
+  for (int32_t i = 0; i < PRESET_NR_OF_REGS_C; i++) {
+    preset->values[i] = vector_get_uint32(buffer, &index);
+  }
+  preset->crc   = preset_crc(preset);
+  preset_validate(preset);
+
+  preset_append_info(response, response_length, slot);
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_preset_apply(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t slot = buffer[1];
+
+  if (slot >= PRESET_SLOTS_C || !preset_slots[slot].valid) {
+    return CMD_FAILED_E;
+  }
+
+  preset_pending = slot;
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_preset_info(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t slot = buffer[1];
+
+  if (slot >= PRESET_SLOTS_C) {
+    return CMD_FAILED_E;
+  }
+
+  preset_append_info(response, response_length, slot);
+  return CMD_OK_E;
+}
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Register preset slots. A slot holds a copy of the RW registers of the
+//   DAFX register file and is applied in one burst of AXI writes from the
+//   irq_1 handler, i.e., aligned to the next sample tick.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PRESET_H
+#define PRESET_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+
+#define PRESET_SLOTS_C      16
+#define PRESET_NR_OF_REGS_C 7
+#define PRESET_NONE_C       -1
+
+typedef struct {
+  volatile uint8_t valid;
+  uint16_t         crc;
+  uint32_t         tag;
+  uint32_t         values[PRESET_NR_OF_REGS_C];
+} preset_slot_t;
+
+void         preset_init();
+void         preset_tick();
+cmd_status_t cmd_preset_capture(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_preset_upload(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_preset_apply(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_preset_info(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif
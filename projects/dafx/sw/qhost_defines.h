@@ -27,6 +27,20 @@
   #define STRING_C             0x50
   #define SAMPLE_MIXER_LEFT_C  0x51
   #define SAMPLE_MIXER_RIGHT_C 0x52
+  #define REGISTER_READ_C      0x53
+  #define LOG_C                0x54
+  #define PRESET_INFO_C        0x56
+  #define SAMPLE_BLOCK_C       0x57
+  #define CAPTURE_C            0x58
+  #define SPECTRUM_C           0x59
+  #define TX_STATS_C           0x5A
+  #define HELLO_C              0x5B
+  #define LINK_C               0x5C
+  #define ECHO_C               0x5D
+
+  #define PROTOCOL_VERSION_C   1
+
+  #define FRAME_LENGTH_MAX_C   256
 
   #define CRC_C     CRC_ENABLED_BIT_C
   #define STR_C     STRING_C
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   See rx_parser.h.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "crc_16.h"
+#include "init_ps.h"
+#include "cmd_table.h"
+#include "log_ring.h"
+#include "rx_parser.h"
+
+extern uint8_t           uart_rx_buffer[UART_RX_RING_SIZE_C];
+extern volatile uint32_t uart_rx_wr_addr;
+extern volatile uint32_t uart_rx_rd_addr;
+extern volatile uint32_t uart_rx_dropped;
+
+rx_state_t       rx_state;
+volatile int32_t rx_crc_enabled;
+int32_t          rx_frame_max;
+static   uint8_t rx_buffer[UART_BUFFER_SIZE_C];
+static  uint32_t rx_dropped_reported;
+volatile int32_t rx_length;
+volatile int32_t rx_addr;
+volatile int16_t rx_crc_high;
+volatile int16_t rx_crc_low;
+
+
+void parse_uart_init() {
+
+  rx_state       = RX_IDLE_E;
+  rx_addr        = 0;
+  rx_length      = 0;
+  rx_crc_high    = 0;
+  rx_crc_low     = 0;
+  rx_crc_enabled = 1;
+  rx_frame_max   = UART_BUFFER_SIZE_C;
+
+  rx_dropped_reported = 0;
+}
+
+
+void parse_uart_rx() {
+
+  uint8_t  rx_data;
+  uint32_t wr_addr = uart_rx_wr_addr;
+  uint32_t dropped = uart_rx_dropped;
+
+  // The RX ISR only counts the bytes it drops on a full ring
+  if (dropped != rx_dropped_reported) {
+    LOG_WARN(LOG_UART_RX_RING_FULL_E, dropped - rx_dropped_reported);
+    rx_dropped_reported = dropped;
+  }
+
+  for (; uart_rx_rd_addr != wr_addr; uart_rx_rd_addr++) {
+
+    rx_data = uart_rx_buffer[uart_rx_rd_addr & (UART_RX_RING_SIZE_C - 1)];
+
+    switch (rx_state) {
+
+      case RX_IDLE_E:
+
+        rx_addr    = 0;
+        rx_length  = 0;
+
+        if (rx_data == LENGTH_8_BITS_C) {
+          rx_state = RX_LENGTH_LOW_E;
+        } else if (rx_data == LENGTH_16_BITS_C) {
+          rx_state = RX_LENGTH_HIGH_E;
+        }
+        break;
+
+
+      case RX_LENGTH_HIGH_E:
+
+        rx_length  = (uint32_t)rx_data << 8;
+        rx_state   = RX_LENGTH_LOW_E;
+        break;
+
+
+      case RX_LENGTH_LOW_E:
+        rx_length |= (uint32_t)rx_data;
+
+        if (rx_length <= rx_frame_max && rx_length > 0) {
+          rx_state = RX_READ_PAYLOAD_E;
+        } else {
+          LOG_WARN(LOG_RX_TOO_LONG_E, rx_length, rx_frame_max);
+          rx_state = RX_IDLE_E;
+        }
+        break;
+
+
+      case RX_READ_PAYLOAD_E:
+
+        rx_buffer[rx_addr++] = rx_data;
+
+        if (rx_addr == rx_length) {
+
+          LOG_DEBUG(LOG_RX_FRAME_E, rx_length);
+
+          if (rx_crc_enabled) {
+            rx_state = RX_READ_CRC_HIGH_E;
+          } else {
+            cmd_dispatch(rx_buffer, rx_length, CMD_CTX_MAIN_C);
+            rx_state = RX_IDLE_E;
+          }
+        }
+        break;
+
+
+      case RX_READ_CRC_HIGH_E:
+
+        rx_state    = RX_READ_CRC_LOW_E;
+        rx_crc_high = (uint16_t)rx_data << 8;
+        break;
+
+
+      case RX_READ_CRC_LOW_E:
+
+        rx_crc_low = (uint16_t)rx_data;
+
+        if (crc_16(rx_buffer, rx_length) == (uint16_t)(rx_crc_high | rx_crc_low)) {
+          cmd_dispatch(rx_buffer, rx_length, CMD_CTX_MAIN_C);
+        } else {
+          LOG_WARN(LOG_RX_BAD_CRC_E, crc_16(rx_buffer, rx_length), (rx_crc_high | rx_crc_low));
+        }
+
+        rx_state = RX_IDLE_E;
+        break;
+
+
+      default:
+        rx_state = RX_IDLE_E;
+        break;
+    }
+  }
+}
+
+
+// Drops a partly received frame, used when the link settings change
+void parse_uart_reset() {
+  rx_state  = RX_IDLE_E;
+  rx_addr   = 0;
+  rx_length = 0;
+}
@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Frame parser of the UART RX ring. A frame is LENGTH_8_BITS_C and an 8 bit
+//   length, or LENGTH_16_BITS_C and a 16 bit length, followed by the payload
+//   and, if enabled, a CRC16. Complete frames are passed to cmd_dispatch().
+//   Kept apart from main() so the host benchmark (host/link_bench.c) runs
+//   the same parser.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RX_PARSER_H
+#define RX_PARSER_H
+
+#include <stdint.h>
+#include "qhost_defines.h"
+
+#define UART_BUFFER_SIZE_C FRAME_LENGTH_MAX_C
+
+typedef enum {
+  RX_IDLE_E,
+  RX_LENGTH_HIGH_E,
+  RX_LENGTH_LOW_E,
+  RX_READ_PAYLOAD_E,
+  RX_READ_CRC_LOW_E,
+  RX_READ_CRC_HIGH_E
+} rx_state_t;
+
+extern volatile int32_t rx_crc_enabled;
+extern int32_t          rx_frame_max;
+
+void parse_uart_init();
+void parse_uart_rx();
+void parse_uart_reset();
+
+#endif
@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Mixer output streaming, see sample_stream.h.
+//
+//   'S' id factor channels  Subscribes stream 'id' to the channels in the
+//                           'channels' mask, decimated by 'factor'. A factor
+//                           of 0 ends the subscription.
+//
+//   Frame: type, id, channels, n, then n samples of signed 24 bit per channel,
+//   left before right.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "byte_vector.h"
+#include "dafx_address.h"
+#include "dafx_axi.h"
+#include "qhost_defines.h"
+#include "tx_mux.h"
+#include "log_ring.h"
+#include "sample_stream.h"
+#include "spectrum.h"
+
+#define SAMPLE_FRAME_MAX_C (4 + 6 * SAMPLE_BLOCK_SIZE_C)
+
+static   int32_t             sample_left[SAMPLE_RING_SIZE_C];
+static   int32_t             sample_right[SAMPLE_RING_SIZE_C];
+volatile uint32_t            sample_wr_addr;
+volatile uint32_t            sample_rd_addr;
+volatile uint32_t            sample_overruns;
+static   uint32_t            sample_overruns_reported;
+static   sample_subscriber_t sample_subscribers[SAMPLE_SUBSCRIBERS_C];
+static   uint8_t             sample_tx_buffer[SAMPLE_FRAME_MAX_C];
+
+
+void sample_stream_init() {
+
+  sample_wr_addr           = 0;
+  sample_rd_addr           = 0;
+  sample_overruns          = 0;
+  sample_overruns_reported = 0;
+
+  for (int32_t i = 0; i < SAMPLE_SUBSCRIBERS_C; i++) {
+    sample_subscribers[i].channels = 0;
+  }
+}
+
+
+void sample_stream_read(int32_t *left, int32_t *right) {
+  *left  = sample_sign_extend(axi_read(FPGA_BASEADDR, DAFX_MIX_OUT_LEFT_ADDR));
+  *right = sample_sign_extend(axi_read(FPGA_BASEADDR, DAFX_MIX_OUT_RIGHT_ADDR));
+}
+
+
+// Called from the irq_1 handler
+void sample_stream_push(int32_t left, int32_t right) {
+
+  uint32_t wr_addr = sample_wr_addr;
+
+  if (wr_addr - sample_rd_addr >= SAMPLE_RING_SIZE_C) {
+    sample_overruns++;
+    return;
+  }
+
+  sample_left[wr_addr & (SAMPLE_RING_SIZE_C - 1)]  = left;
+  sample_right[wr_addr & (SAMPLE_RING_SIZE_C - 1)] = right;
+  sample_wr_addr = wr_addr + 1;
+}
+
+
+static void sample_stream_send(int32_t id, uint8_t channels, const int32_t *left, const int32_t *right, int32_t length) {
+
+  int32_t index = 0;
+
+  sample_tx_buffer[index++] = SAMPLE_BLOCK_C;
+  sample_tx_buffer[index++] = id;
+  sample_tx_buffer[index++] = channels;
+  sample_tx_buffer[index++] = length;
+
+  for (int32_t i = 0; i < length; i++) {
+    if (channels & SAMPLE_CHANNEL_LEFT_C) {
+      vector_append_int24(sample_tx_buffer, left[i], &index);
+    }
+    if (channels & SAMPLE_CHANNEL_RIGHT_C) {
+      vector_append_int24(sample_tx_buffer, right[i], &index);
+    }
+  }
+
+  tx_mux_send(sample_tx_buffer, index);
+}
+
+
+// Called from the main loop, processes all complete blocks in the ring
+void sample_stream_poll() {
+
+  int32_t              left[SAMPLE_BLOCK_SIZE_C];
+  int32_t              right[SAMPLE_BLOCK_SIZE_C];
+  int32_t              out_left[SAMPLE_BLOCK_SIZE_C];
+  int32_t              out_right[SAMPLE_BLOCK_SIZE_C];
+  int32_t              length;
+  uint32_t             rd_addr;
+  uint32_t             overruns;
+  sample_subscriber_t *sub;
+
+  overruns = sample_overruns;
+  if (overruns != sample_overruns_reported) {
+    LOG_WARN(LOG_SAMPLE_OVERRUN_E, overruns - sample_overruns_reported);
+    sample_overruns_reported = overruns;
+  }
+
+  while (sample_wr_addr - sample_rd_addr >= SAMPLE_BLOCK_SIZE_C) {
+
+    rd_addr = sample_rd_addr;
+    for (int32_t i = 0; i < SAMPLE_BLOCK_SIZE_C; i++) {
+      left[i]  = sample_left[(rd_addr + i) & (SAMPLE_RING_SIZE_C - 1)];
+      right[i] = sample_right[(rd_addr + i) & (SAMPLE_RING_SIZE_C - 1)];
+    }
+    sample_rd_addr = rd_addr + SAMPLE_BLOCK_SIZE_C;
+
+    spectrum_push_block(left, right, SAMPLE_BLOCK_SIZE_C);
+
+    for (int32_t id = 0; id < SAMPLE_SUBSCRIBERS_C; id++) {
+
+      sub    = &sample_subscribers[id];
+      length = 0;
+
+      if (sub->channels & SAMPLE_CHANNEL_LEFT_C) {
+        length = decimator_process(&sub->left, left, SAMPLE_BLOCK_SIZE_C, out_left);
+      }
+      if (sub->channels & SAMPLE_CHANNEL_RIGHT_C) {
+        length = decimator_process(&sub->right, right, SAMPLE_BLOCK_SIZE_C, out_right);
+      }
+      if (length > 0) {
+        sample_stream_send(id, sub->channels, out_left, out_right, length);
+      }
+    }
+  }
+}
+
+
+int32_t sample_stream_subscribe(int32_t id, int32_t factor, uint8_t channels) {
+
+  sample_subscriber_t *sub;
+
+  if (id < 0 || id >= SAMPLE_SUBSCRIBERS_C) {
+    return -1;
+  }
+
+  sub           = &sample_subscribers[id];
+  sub->channels = 0;
+
+  if (factor == 0) {
+    return 0;
+  }
+
+  if (decimator_design(&sub->coefs, factor) != 0) {
+    return -1;
+  }
+
+  decimator_init(&sub->left,  &sub->coefs);
+  decimator_init(&sub->right, &sub->coefs);
+  sub->channels = channels & (SAMPLE_CHANNEL_LEFT_C | SAMPLE_CHANNEL_RIGHT_C);
+
+  return 0;
+}
+
+
+cmd_status_t cmd_sample_subscribe(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  if (sample_stream_subscribe(buffer[1], buffer[2], buffer[3]) != 0) {
+    return CMD_FAILED_E;
+  }
+  return CMD_OK_E;
+}
@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Streams the mixer output to the host. The irq_1 handler reads
+//   DAFX_MIX_OUT_LEFT/RIGHT into a sample ring, and the main loop takes whole
+//   blocks from the ring, decimates them per subscriber and sends
+//   SAMPLE_BLOCK_C frames.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+#include "decimator.h"
+
+#define SAMPLE_RING_SIZE_C        1024 // Must be a power of two
+#define SAMPLE_BLOCK_SIZE_C       32
+#define SAMPLE_SUBSCRIBERS_C      4
+
+#define SAMPLE_CHANNEL_LEFT_C     0x01
+#define SAMPLE_CHANNEL_RIGHT_C    0x02
+
+_Static_assert((SAMPLE_RING_SIZE_C & (SAMPLE_RING_SIZE_C - 1)) == 0, "SAMPLE_RING_SIZE_C must be a power of two");
+
+typedef struct {
+  uint8_t           channels;
+  decimator_coefs_t coefs;
+  decimator_t       left;
+  decimator_t       right;
+} sample_subscriber_t;
+
+// The mixer outputs are 24 bit
+static inline int32_t sample_sign_extend(uint32_t data) {
+  return (int32_t)(data << 8) >> 8;
+}
+
+void         sample_stream_init();
+void         sample_stream_read(int32_t *left, int32_t *right);
+void         sample_stream_push(int32_t left, int32_t right);
+void         sample_stream_poll();
+int32_t      sample_stream_subscribe(int32_t id, int32_t factor, uint8_t channels);
+cmd_status_t cmd_sample_subscribe(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif
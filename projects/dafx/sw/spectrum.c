@@ -0,0 +1,235 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Spectrum telemetry, see spectrum.h.
+//
+//   'X' channels size_log2 averages nr_of_bins flags
+//         'channels' is a SAMPLE_CHANNEL_* mask, 0 turns the spectrum off.
+//         'size_log2' is 6..10, 'averages' 1..16 and 'nr_of_bins' 1..125.
+//         SPECTRUM_LOG_BINS_C in 'flags' selects log spaced bins.
+//
+//   Frame: type, channel, size_log2, flags, n, then n uint16 bins holding the
+//   average power in dB relative to one LSB of the Q15 FFT, in Q8.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "byte_vector.h"
+#include "qhost_defines.h"
+#include "tx_mux.h"
+#include "sample_stream.h"
+#include "spectrum.h"
+
+#define SPECTRUM_FRAME_MAX_C (5 + 2 * SPECTRUM_MAX_BINS_C)
+#define SPECTRUM_PI_C        3.14159265358979f
+
+_Static_assert(SPECTRUM_FRAME_MAX_C <= FRAME_LENGTH_MAX_C, "A spectrum frame must fit in FRAME_LENGTH_MAX_C");
+
+static fft_q15_t          spectrum_fft;
+static int16_t            spectrum_window[FFT_MAX_SIZE_C];
+static spectrum_channel_t spectrum_channels[2];
+static uint16_t           spectrum_edges[SPECTRUM_MAX_BINS_C + 1];
+static uint8_t            spectrum_enabled;
+static uint8_t            spectrum_flags;
+static int32_t            spectrum_averages;
+static int32_t            spectrum_nr_of_bins;
+static int32_t            spectrum_fill;
+static int32_t            spectrum_count;
+static uint8_t            spectrum_tx_buffer[SPECTRUM_FRAME_MAX_C];
+
+
+void spectrum_init() {
+  spectrum_enabled = 0;
+}
+
+
+// Bin j covers the FFT bins [edges[j], edges[j + 1]), DC is left out
+static int32_t spectrum_make_edges(int32_t size, int32_t nr_of_bins, uint8_t flags) {
+
+  int32_t lo = 1;
+  int32_t hi = size / 2 + 1;
+  int32_t edge;
+
+  if (nr_of_bins > hi - lo) {
+    nr_of_bins = hi - lo;
+  }
+
+  spectrum_edges[0] = lo;
+  for (int32_t j = 1; j < nr_of_bins; j++) {
+    if (flags & SPECTRUM_LOG_BINS_C) {
+      edge = (int32_t)(lo * powf((float)hi / lo, (float)j / nr_of_bins));
+    } else {
+      edge = lo + j * (hi - lo) / nr_of_bins;
+    }
+    // Every bin covers at least one FFT bin and leaves room for the rest
+    if (edge <= spectrum_edges[j - 1]) {
+      edge = spectrum_edges[j - 1] + 1;
+    }
+    if (edge > hi - (nr_of_bins - j)) {
+      edge = hi - (nr_of_bins - j);
+    }
+    spectrum_edges[j] = edge;
+  }
+  spectrum_edges[nr_of_bins] = hi;
+
+  return nr_of_bins;
+}
+
+
+int32_t spectrum_config(uint8_t channels, int32_t size_log2, int32_t averages, int32_t nr_of_bins, uint8_t flags) {
+
+  int32_t size;
+
+  spectrum_enabled = 0;
+
+  if (channels == 0) {
+    return 0;
+  }
+
+  if (size_log2 < SPECTRUM_MIN_SIZE_LOG2_C || averages < 1 || averages > SPECTRUM_MAX_AVERAGES_C ||
+      nr_of_bins < 1 || nr_of_bins > SPECTRUM_MAX_BINS_C || fft_q15_init(&spectrum_fft, size_log2) != 0) {
+    return -1;
+  }
+
+  size = 1 << size_log2;
+  for (int32_t i = 0; i < size; i++) {
+    spectrum_window[i] = (int16_t)lrintf(32767.0f * (0.5f - 0.5f * cosf(2.0f * SPECTRUM_PI_C * i / size)));
+  }
+
+  for (int32_t c = 0; c < 2; c++) {
+    for (int32_t k = 0; k <= size / 2; k++) {
+      spectrum_channels[c].power[k] = 0;
+    }
+  }
+
+  spectrum_averages   = averages;
+  spectrum_flags      = flags;
+  spectrum_nr_of_bins = spectrum_make_edges(size, nr_of_bins, flags);
+  spectrum_fill       = 0;
+  spectrum_count      = 0;
+  spectrum_enabled    = channels & (SAMPLE_CHANNEL_LEFT_C | SAMPLE_CHANNEL_RIGHT_C);
+
+  return 0;
+}
+
+
+static void spectrum_transform(spectrum_channel_t *ch) {
+
+  const int32_t size = spectrum_fft.size;
+
+  for (int32_t i = 0; i < size; i++) {
+    ch->re[i] = ((int32_t)ch->input[i] * spectrum_window[i] + (1 << 14)) >> 15;
+    ch->im[i] = 0;
+  }
+
+  fft_q15(&spectrum_fft, ch->re, ch->im);
+
+  for (int32_t k = 0; k <= size / 2; k++) {
+    ch->power[k] += (uint32_t)((int32_t)ch->re[k] * ch->re[k]) + (uint32_t)((int32_t)ch->im[k] * ch->im[k]);
+  }
+}
+
+
+static void spectrum_clear(spectrum_channel_t *ch) {
+  for (int32_t k = 0; k <= spectrum_fft.size / 2; k++) {
+    ch->power[k] = 0;
+  }
+}
+
+
+static void spectrum_send(int32_t channel, spectrum_channel_t *ch) {
+
+  int32_t  index = 0;
+  uint64_t sum;
+  float    mean;
+
+  // Like a capture chunk the frame is only built if its queue has room, a
+  // spectrum that does not fit is skipped and its averages are restarted
+  if (tx_mux_free(SPECTRUM_C) < 5 + 2 * spectrum_nr_of_bins) {
+    spectrum_clear(ch);
+    return;
+  }
+
+  spectrum_tx_buffer[index++] = SPECTRUM_C;
+  spectrum_tx_buffer[index++] = channel;
+  spectrum_tx_buffer[index++] = spectrum_fft.size_log2;
+  spectrum_tx_buffer[index++] = spectrum_flags;
+  spectrum_tx_buffer[index++] = spectrum_nr_of_bins;
+
+  for (int32_t j = 0; j < spectrum_nr_of_bins; j++) {
+    sum = 0;
+    for (int32_t k = spectrum_edges[j]; k < spectrum_edges[j + 1]; k++) {
+      sum += ch->power[k];
+    }
+    mean = (float)sum / (spectrum_averages * (spectrum_edges[j + 1] - spectrum_edges[j]));
+    vector_append_uint16(spectrum_tx_buffer, (uint16_t)(10.0f * log10f(mean + 1.0f) * 256.0f), &index);
+  }
+
+  spectrum_clear(ch);
+  tx_mux_send(spectrum_tx_buffer, index);
+}
+
+
+// Called from the main loop with every block of the sample stream
+void spectrum_push_block(const int32_t *left, const int32_t *right, int32_t length) {
+
+  const int32_t *input[2] = {left, right};
+
+  if (!spectrum_enabled) {
+    return;
+  }
+
+  for (int32_t i = 0; i < length; i++) {
+
+    // The 24 bit samples are truncated to Q15
+    for (int32_t c = 0; c < 2; c++) {
+      spectrum_channels[c].input[spectrum_fill] = input[c][i] >> 8;
+    }
+
+    if (++spectrum_fill < spectrum_fft.size) {
+      continue;
+    }
+    spectrum_fill = 0;
+
+    for (int32_t c = 0; c < 2; c++) {
+      if (spectrum_enabled & (1 << c)) {
+        spectrum_transform(&spectrum_channels[c]);
+      }
+    }
+
+    if (++spectrum_count < spectrum_averages) {
+      continue;
+    }
+    spectrum_count = 0;
+
+    for (int32_t c = 0; c < 2; c++) {
+      if (spectrum_enabled & (1 << c)) {
+        spectrum_send(c, &spectrum_channels[c]);
+      }
+    }
+  }
+}
+
+
+cmd_status_t cmd_spectrum_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  if (spectrum_config(buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]) != 0) {
+    return CMD_FAILED_E;
+  }
+  return CMD_OK_E;
+}
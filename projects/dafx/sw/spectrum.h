@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Spectrum telemetry of the mixer output. Blocks from the sample stream are
+//   windowed (Hann), transformed with fft_q15(), averaged over a number of
+//   transforms and reduced to a small number of linear or log spaced bins
+//   before they are sent as SPECTRUM_C frames.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+#include "fft_q15.h"
+
+#define SPECTRUM_MIN_SIZE_LOG2_C 6
+#define SPECTRUM_MAX_AVERAGES_C  16
+#define SPECTRUM_MAX_BINS_C      125 // A frame of 5 + 2 * 125 bytes fits in FRAME_LENGTH_MAX_C
+#define SPECTRUM_LOG_BINS_C      0x01
+
+typedef struct {
+  int16_t  input[FFT_MAX_SIZE_C];
+  int16_t  re[FFT_MAX_SIZE_C];
+  int16_t  im[FFT_MAX_SIZE_C];
+  uint64_t power[FFT_MAX_SIZE_C / 2 + 1];
+} spectrum_channel_t;
+
+void         spectrum_init();
+void         spectrum_push_block(const int32_t *left, const int32_t *right, int32_t length);
+int32_t      spectrum_config(uint8_t channels, int32_t size_log2, int32_t averages, int32_t nr_of_bins, uint8_t flags);
+cmd_status_t cmd_spectrum_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   Single producer, single consumer frame queue. The producer owns wr_addr
+//   and the consumer owns rd_addr, so no lock is needed; acquire/release
+//   ordering on the two indices is all that is shared. On the Cortex-A9 the
+//   __atomic builtins give dmb barriers, on a host they give the normal C11
+//   ordering, so the same header is used by both cores of the AMP build and
+//   by the pthread test in host/.
+//
+//   Frames are stored as a 16 bit length followed by the bytes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+
+#define SPSC_CACHE_LINE_C 32 // L1 line size of the Cortex-A9
+
+// The indices are free running and placed on separate cache lines so the two
+// cores never write to the same line
+typedef struct {
+  uint32_t wr_addr __attribute__((aligned(SPSC_CACHE_LINE_C)));
+  uint32_t rd_addr __attribute__((aligned(SPSC_CACHE_LINE_C)));
+  uint32_t size    __attribute__((aligned(SPSC_CACHE_LINE_C)));
+  uint8_t *data;
+  uint32_t peak;     // Written by the producer only
+  uint32_t dropped;  // Written by the producer only
+} spsc_queue_t;
+
+
+// 'size' must be a power of two. Called before either side uses the queue.
+static inline void spsc_init(spsc_queue_t *q, uint8_t *data, uint32_t size) {
+  q->data    = data;
+  q->size    = size;
+  q->peak    = 0;
+  q->dropped = 0;
+  q->rd_addr = 0;
+  __atomic_store_n(&q->wr_addr, 0, __ATOMIC_RELEASE);
+}
+
+
+// Free bytes for a frame, the length field excluded. Producer side.
+static inline int32_t spsc_free(spsc_queue_t *q) {
+  uint32_t rd   = __atomic_load_n(&q->rd_addr, __ATOMIC_ACQUIRE);
+  int32_t  free = (int32_t)(q->size - (q->wr_addr - rd)) - 2;
+  return (free < 0) ? 0 : free;
+}
+
+
+// Returns 0 if the frame was queued and -1 if the queue is full
+static inline int32_t spsc_push(spsc_queue_t *q, const uint8_t *frame, int32_t length) {
+
+  uint32_t mask = q->size - 1;
+  uint32_t wr   = q->wr_addr;
+  uint32_t rd   = __atomic_load_n(&q->rd_addr, __ATOMIC_ACQUIRE);
+  uint32_t used = wr - rd;
+
+  if (q->size - used < (uint32_t)length + 2) {
+    q->dropped++;
+    return -1;
+  }
+
+  q->data[wr++ & mask] = (uint8_t)(length >> 8);
+  q->data[wr++ & mask] = (uint8_t)length;
+  for (int32_t i = 0; i < length; i++) {
+    q->data[wr++ & mask] = frame[i];
+  }
+
+  if (wr - rd > q->peak) {
+    q->peak = wr - rd;
+  }
+
+  // Publishes the bytes above before the new index
+  __atomic_store_n(&q->wr_addr, wr, __ATOMIC_RELEASE);
+  return 0;
+}
+
+
+// Length of the next frame and its first byte, 0 if the queue is empty
+static inline int32_t spsc_peek(spsc_queue_t *q, uint8_t *first) {
+
+  uint32_t mask = q->size - 1;
+  uint32_t rd   = q->rd_addr;
+  uint32_t wr   = __atomic_load_n(&q->wr_addr, __ATOMIC_ACQUIRE);
+  int32_t  length;
+
+  if (rd == wr) {
+    return 0;
+  }
+
+  length  = (int32_t)q->data[rd & mask] << 8;
+  length |= (int32_t)q->data[(rd + 1) & mask];
+  *first  = q->data[(rd + 2) & mask];
+  return length;
+}
+
+
+// Returns the length of the frame copied to 'frame', 0 if the queue is empty
+// and -1 if the next frame is longer than 'max_length', which is then skipped
+static inline int32_t spsc_pop(spsc_queue_t *q, uint8_t *frame, int32_t max_length) {
+
+  uint32_t mask = q->size - 1;
+  uint32_t rd   = q->rd_addr;
+  uint32_t wr   = __atomic_load_n(&q->wr_addr, __ATOMIC_ACQUIRE);
+  int32_t  length;
+
+  if (rd == wr) {
+    return 0;
+  }
+
+  length  = (int32_t)q->data[rd++ & mask] << 8;
+  length |= (int32_t)q->data[rd++ & mask];
+
+  if (length > max_length) {
+    __atomic_store_n(&q->rd_addr, rd + length, __ATOMIC_RELEASE);
+    return -1;
+  }
+
+  for (int32_t i = 0; i < length; i++) {
+    frame[i] = q->data[rd++ & mask];
+  }
+
+  // The producer may reuse the bytes once the new index is seen
+  __atomic_store_n(&q->rd_addr, rd, __ATOMIC_RELEASE);
+  return length;
+}
+
+#endif
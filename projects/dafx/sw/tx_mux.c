@@ -0,0 +1,346 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   TX multiplexer, see tx_mux.h.
+//
+//   'M' type  Replies with a TX_STATS_C frame of the stream of 'type':
+//             stream, bytes sent (4), frames sent (4), dropped (4),
+//             decimated (4), queued bytes (2), peak queued bytes (2)
+//   'Q' type quantum rate policy decimation
+//             Sets the weight (uint16), the budget in bytes/s (uint32, 0 is
+//             unlimited) and the over budget policy of the stream of 'type'
+//
+//   Frames are queued as a uint16 length followed by the frame. Text printed
+//   with xil_printf() does not pass the multiplexer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "xuartps.h"
+#include "xtime_l.h"
+#include "byte_vector.h"
+#include "qhost_defines.h"
+#include "tx_mux.h"
+#include "amp.h"
+
+#define TX_BURST_MS_C 100 // Tokens saved up while a stream is idle
+
+extern XUartPs Uart_PS;
+
+#define TX_STREAM_QUEUE(stream, queue_size, quantum, rate, policy, decimation) \
+  static uint8_t stream##_queue[queue_size]; \
+  _Static_assert(((queue_size) & ((queue_size) - 1)) == 0, #stream " queue size must be a power of two");
+TX_STREAMS(TX_STREAM_QUEUE)
+
+#define TX_STREAM_INIT(stream, queue_size, quantum, rate, policy, decimation) \
+  [stream] = {stream##_queue, queue_size, 0, 0, 0, quantum, 0, rate, 0, 0, policy, decimation},
+static tx_stream_t tx_streams[TX_NR_OF_STREAMS_E] = {
+  TX_STREAMS(TX_STREAM_INIT)
+};
+
+static uint8_t  tx_stream_of[256];
+static uint64_t tx_last_refill;
+
+// Scheduler state
+static int32_t  tx_rr;
+static int32_t  tx_visited;
+static int32_t  tx_current;
+static int32_t  tx_remaining;
+static int32_t  tx_reply_only;
+
+
+// At most 2^32 * TX_BURST_MS_C / 1000 + FRAME_LENGTH_MAX_C, so it fits int32_t
+static inline int32_t tx_mux_burst(const tx_stream_t *s) {
+  return (int32_t)((uint64_t)s->rate * TX_BURST_MS_C / 1000) + FRAME_LENGTH_MAX_C;
+}
+
+
+void tx_mux_init() {
+
+  XTime now;
+
+  // Replies and everything without a stream of its own share one stream
+  for (int32_t i = 0; i < 256; i++) {
+    tx_stream_of[i] = TX_STREAM_REPLY_E;
+  }
+  tx_stream_of[SAMPLE_BLOCK_C] = TX_STREAM_SAMPLE_E;
+  tx_stream_of[CAPTURE_C]      = TX_STREAM_CAPTURE_E;
+  tx_stream_of[SPECTRUM_C]     = TX_STREAM_SPECTRUM_E;
+  tx_stream_of[LOG_C]          = TX_STREAM_LOG_E;
+
+  // Every budget starts with a full burst
+  for (int32_t i = 0; i < TX_NR_OF_STREAMS_E; i++) {
+    tx_streams[i].tokens = tx_mux_burst(&tx_streams[i]);
+  }
+
+  XTime_GetTime(&now);
+  tx_last_refill = now;
+  tx_rr          = 0;
+  tx_visited     = 0;
+  tx_reply_only  = 0;
+  tx_remaining   = 0;
+}
+
+
+static inline uint32_t tx_queue_used(const tx_stream_t *s) {
+  return s->wr_addr - s->rd_addr;
+}
+
+
+static inline uint8_t tx_queue_get(tx_stream_t *s) {
+  return s->queue[s->rd_addr++ & (s->queue_size - 1)];
+}
+
+
+static inline void tx_queue_put(tx_stream_t *s, uint8_t data) {
+  s->queue[s->wr_addr++ & (s->queue_size - 1)] = data;
+}
+
+
+static void tx_mux_refill() {
+
+  XTime    now;
+  uint64_t elapsed;
+  uint64_t credit;
+  int32_t  burst;
+  int64_t  tokens;
+
+  XTime_GetTime(&now);
+  elapsed = now - tx_last_refill;
+
+  // Refilled at most every millisecond. The fraction of a byte that does not
+  // make a whole token is carried to the next refill, so slow rates still
+  // accumulate tokens.
+  if (elapsed < COUNTS_PER_SECOND / 1000) {
+    return;
+  }
+  if (elapsed > COUNTS_PER_SECOND) {
+    elapsed = COUNTS_PER_SECOND;
+  }
+  tx_last_refill = now;
+
+  for (int32_t i = 0; i < TX_NR_OF_STREAMS_E; i++) {
+    tx_stream_t *s = &tx_streams[i];
+    if (s->rate == 0) {
+      continue;
+    }
+    burst         = tx_mux_burst(s);
+    credit        = elapsed * s->rate + s->token_frac;
+    s->token_frac = credit % COUNTS_PER_SECOND;
+    tokens        = s->tokens + (int64_t)(credit / COUNTS_PER_SECOND);
+    s->tokens     = (tokens > burst) ? burst : (int32_t)tokens;
+  }
+}
+
+
+// Queues a whole frame, buffer[0] is its type. Returns 0 if the frame was
+// queued and -1 if it was dropped or decimated.
+int32_t tx_mux_send(const uint8_t *buffer, int32_t length) {
+
+  tx_stream_t *s = &tx_streams[tx_stream_of[buffer[0]]];
+
+  // CPU1 has no UART, its frames are queued by CPU0
+  if (AMP_RT_CORE_C) {
+    return amp_forward_frame(buffer, length);
+  }
+
+  if (s->queue_size - tx_queue_used(s) < (uint32_t)length + 2) {
+    s->frames_dropped++;
+    return -1;
+  }
+
+  if (s->rate != 0) {
+    tx_mux_refill();
+    if (s->tokens < length) {
+      if (s->policy == TX_POLICY_DROP_E) {
+        s->frames_dropped++;
+        return -1;
+      }
+      if ((++s->over_budget % s->decimation) != 0) {
+        s->frames_decimated++;
+        return -1;
+      }
+    }
+  }
+
+  tx_queue_put(s, length >> 8);
+  tx_queue_put(s, length);
+  for (int32_t i = 0; i < length; i++) {
+    tx_queue_put(s, buffer[i]);
+  }
+
+  // Only queued frames are charged. Decimated frames that are still sent put
+  // the stream in debt, at most one burst so it recovers once the load drops.
+  if (s->rate != 0) {
+    s->tokens -= length;
+    if (s->tokens < -tx_mux_burst(s)) {
+      s->tokens = -tx_mux_burst(s);
+    }
+  }
+
+  if (tx_queue_used(s) > s->queue_peak) {
+    s->queue_peak = tx_queue_used(s);
+  }
+
+  return 0;
+}
+
+
+int32_t tx_mux_stream(uint8_t type) {
+  return tx_stream_of[type];
+}
+
+
+// Free bytes for a frame of 'type', the length field excluded
+int32_t tx_mux_free(uint8_t type) {
+
+  tx_stream_t *s    = &tx_streams[tx_stream_of[type]];
+  int32_t      free = s->queue_size - tx_queue_used(s) - 2;
+
+  if (AMP_RT_CORE_C) {
+    return amp_forward_free(type);
+  }
+
+  return (free < 0) ? 0 : free;
+}
+
+
+// Deficit round robin. A stream gets its quantum once per visit and sends
+// frames while they fit in its deficit. Returns 0 if all queues are empty.
+static int32_t tx_mux_next() {
+
+  tx_stream_t *s;
+  int32_t      length;
+  int32_t      empty = 0;
+
+  while (empty < TX_NR_OF_STREAMS_E) {
+
+    s = &tx_streams[tx_rr];
+
+    if (tx_queue_used(s) == 0 || (tx_reply_only && tx_rr != TX_STREAM_REPLY_E)) {
+      s->deficit = 0;
+      empty++;
+    } else {
+      empty = 0;
+      if (!tx_visited) {
+        s->deficit += s->quantum;
+        tx_visited  = 1;
+      }
+      length = (int32_t)s->queue[s->rd_addr & (s->queue_size - 1)] << 8 |
+                        s->queue[(s->rd_addr + 1) & (s->queue_size - 1)];
+      if (length <= s->deficit) {
+        s->deficit  -= length;
+        s->rd_addr  += 2;
+        tx_current   = tx_rr;
+        tx_remaining = length;
+        return 1;
+      }
+    }
+
+    tx_rr      = (tx_rr + 1) % TX_NR_OF_STREAMS_E;
+    tx_visited = 0;
+  }
+
+  return 0;
+}
+
+
+// Called from the main loop, fills the TX FIFO without waiting
+void tx_mux_poll() {
+
+  uint32_t     base = Uart_PS.Config.BaseAddress;
+  tx_stream_t *s;
+
+  while (!XUartPs_IsTransmitFull(base)) {
+
+    if (tx_remaining == 0 && !tx_mux_next()) {
+      return;
+    }
+
+    s = &tx_streams[tx_current];
+    XUartPs_WriteReg(base, XUARTPS_FIFO_OFFSET, tx_queue_get(s));
+    s->bytes_sent++;
+
+    if (--tx_remaining == 0) {
+      s->frames_sent++;
+    }
+  }
+}
+
+
+// While set, only the reply stream is scheduled. The frame being sent is
+// finished first, the other streams keep queuing under their policies.
+void tx_mux_reply_only(int32_t enable) {
+  tx_reply_only = enable;
+}
+
+
+// Returns 1 when no frame is being sent, the reply stream is empty and the
+// last byte has left the shift register, i.e., the UART can be reconfigured
+int32_t tx_mux_idle() {
+
+  uint32_t sr = XUartPs_ReadReg(Uart_PS.Config.BaseAddress, XUARTPS_SR_OFFSET);
+
+  return tx_remaining == 0 &&
+         tx_queue_used(&tx_streams[TX_STREAM_REPLY_E]) == 0 &&
+         (sr & (XUARTPS_SR_TXEMPTY | XUARTPS_SR_TACTIVE)) == XUARTPS_SR_TXEMPTY;
+}
+
+
+cmd_status_t cmd_tx_mux_stats(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t      index = 0;
+  int32_t      id    = tx_stream_of[buffer[1]];
+  tx_stream_t *s     = &tx_streams[id];
+
+  response[index++] = TX_STATS_C;
+  response[index++] = id;
+  vector_append_uint32(response, s->bytes_sent,       &index);
+  vector_append_uint32(response, s->frames_sent,      &index);
+  vector_append_uint32(response, s->frames_dropped,   &index);
+  vector_append_uint32(response, s->frames_decimated, &index);
+  vector_append_uint16(response, tx_queue_used(s),    &index);
+  vector_append_uint16(response, s->queue_peak,       &index);
+  *response_length = index;
+
+  return CMD_OK_E;
+}
+
+
+cmd_status_t cmd_tx_mux_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length) {
+
+  int32_t      index      = 2;
+  tx_stream_t *s          = &tx_streams[tx_stream_of[buffer[1]]];
+  int32_t      quantum    = vector_get_uint16(buffer, &index);
+  uint32_t     rate       = vector_get_uint32(buffer, &index);
+  uint8_t      policy     = buffer[index++];
+  uint8_t      decimation = buffer[index++];
+
+  if (quantum == 0 || policy > TX_POLICY_DECIMATE_E || decimation == 0) {
+    return CMD_FAILED_E;
+  }
+
+  s->quantum     = quantum;
+  s->rate        = rate;
+  s->tokens      = tx_mux_burst(s);
+  s->token_frac  = 0;
+  s->policy      = policy;
+  s->decimation  = decimation;
+  s->over_budget = 0;
+
+  return CMD_OK_E;
+}
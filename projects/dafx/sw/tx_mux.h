@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2020 Fredrik Åkerlund
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Description:
+//   TX multiplexer. Every frame sent to the host is queued on the stream of
+//   its type byte (qhost_defines.h). tx_mux_poll() fills the UART TX FIFO from
+//   the queues with deficit round robin scheduling, whole frames at a time.
+//   Each stream can have a byte rate budget; frames above the budget are
+//   dropped or decimated depending on the stream's policy.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TX_MUX_H
+#define TX_MUX_H
+
+#include <stdint.h>
+#include "cmd_table.h"
+
+typedef enum {
+  TX_POLICY_DROP_E,     // Frames above the budget are dropped
+  TX_POLICY_DECIMATE_E  // Every decimation:th frame above the budget is still sent
+} tx_policy_t;
+
+// X(stream, queue_size, quantum, rate, policy, decimation)
+//   queue_size  Bytes, must be a power of two
+//   quantum     Bytes added to the deficit per round, i.e., the weight
+//   rate        Budget in bytes per second, 0 is unlimited
+#define TX_STREAMS(X) \
+  X(TX_STREAM_REPLY_E,    1024,  64,    0, TX_POLICY_DROP_E,     1) \
+  X(TX_STREAM_SAMPLE_E,   4096, 256,    0, TX_POLICY_DROP_E,     1) \
+  X(TX_STREAM_CAPTURE_E,  1024, 128,    0, TX_POLICY_DROP_E,     1) \
+  X(TX_STREAM_SPECTRUM_E, 1024,  64, 4000, TX_POLICY_DECIMATE_E, 2) \
+  X(TX_STREAM_LOG_E,       512,  32, 2000, TX_POLICY_DROP_E,     1)
+
+#define TX_STREAM_ID(stream, queue_size, quantum, rate, policy, decimation) stream,
+typedef enum {
+  TX_STREAMS(TX_STREAM_ID)
+  TX_NR_OF_STREAMS_E
+} tx_stream_id_t;
+#undef TX_STREAM_ID
+
+typedef struct {
+  uint8_t  *queue;
+  uint32_t  queue_size;
+  uint32_t  wr_addr;
+  uint32_t  rd_addr;
+  uint32_t  queue_peak;
+  int32_t   quantum;
+  int32_t   deficit;
+  uint32_t  rate;
+  int32_t   tokens;
+  uint64_t  token_frac; // Remainder of the refills, in timer counts * bytes/s
+  uint8_t   policy;
+  uint8_t   decimation;
+  uint32_t  over_budget;
+  uint32_t  bytes_sent;
+  uint32_t  frames_sent;
+  uint32_t  frames_dropped;
+  uint32_t  frames_decimated;
+} tx_stream_t;
+
+void         tx_mux_init();
+int32_t      tx_mux_send(const uint8_t *buffer, int32_t length);
+int32_t      tx_mux_free(uint8_t type);
+int32_t      tx_mux_stream(uint8_t type);
+void         tx_mux_poll();
+void         tx_mux_reply_only(int32_t enable);
+int32_t      tx_mux_idle();
+cmd_status_t cmd_tx_mux_stats(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+cmd_status_t cmd_tx_mux_config(const uint8_t *buffer, int32_t length, uint8_t *response, int32_t *response_length);
+
+#endif